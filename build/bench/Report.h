@@ -0,0 +1,76 @@
+#ifndef REPORT_H_
+#define REPORT_H_
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <thread>
+#include <cmath>
+
+#include "tsu.h"
+
+// Report
+// - benchmark results written as json so runs can be compared between
+// - releases. Every result has a name and numeric fields, the report adds
+// - when and where it ran.
+// - Example:
+//  Report report ("bench");
+//  report.Add ("SplitString", {{"ns_per_op", 41.5}});
+//  report.Write ("bin/debug/bench.json");
+class Report {
+public:
+    typedef std::vector <std::pair <std::string, double>> fields;
+
+    Report (const std::string& name) : name_(name) {}
+
+    void Add (const std::string& result, const fields& values) {
+        results_.push_back ({result, values});
+    }
+
+    // Write
+    // - print the results and write the json file
+    bool Write (const std::string& filename) {
+        std::ostringstream json;
+        json.precision (10);
+        json << "{\n  \"benchmark\": \"" << name_ << "\",\n"
+            << "  \"time\": \"" << tsu::GetDateTime () << "\",\n"
+            << "  \"compiler\": \"" << __VERSION__ << "\",\n"
+            << "  \"cores\": " << std::thread::hardware_concurrency ()
+            << ",\n  \"results\": [";
+        for (unsigned int i = 0; i < results_.size (); i++) {
+            std::cout << results_[i].first;
+            json << (i > 0 ? "," : "") << "\n    {\"name\": \""
+                << results_[i].first << "\"";
+            for (auto& field : results_[i].second) {
+                std::cout << '\t' << field.first << ' ' << field.second;
+                json << ", \"" << field.first << "\": ";
+                if (std::isfinite (field.second)) {
+                    json << field.second;
+                } else {
+                    json << "null";
+                }
+            }
+            std::cout << '\n';
+            json << "}";
+        }
+        json << "\n  ]\n}\n";
+
+        std::ofstream file (filename);
+        if (!file) {
+            std::cout << "[ERROR] : unable to write " << filename << '\n';
+            return false;
+        }
+        file << json.str ();
+        std::cout << "results written to " << filename << '\n';
+        return true;
+    }  // end Write
+
+private:
+    std::string name_;
+    std::vector <std::pair <std::string, fields>> results_;
+};
+
+#endif // REPORT_H_
@@ -0,0 +1,207 @@
+// Fleet Benchmark
+// - checks that ResourceFleet matches DistributedEnergyResource unit for
+// - unit and gives the same results with any number of threads, then
+// - reports how many unit steps per second the fleet runs.
+// - Usage:
+//  fleet_bench [units] [steps] [threads]
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "DistributedEnergyResource.hpp"
+#include "ResourceFleet.h"
+#include "tsu.h"
+
+namespace {
+
+typedef std::chrono::steady_clock clock;
+
+tsu::string_map Ratings () {
+    tsu::string_map init;
+    init["ExportPower"] = "3000";
+    init["ExportEnergy"] = "20000";
+    init["ExportRamp"] = "1000";
+    init["ImportPower"] = "3000";
+    init["ImportEnergy"] = "20000";
+    init["ImportRamp"] = "1000";
+    init["IdleLosses"] = "20";
+    return init;
+}
+
+// Dispatch
+// - random import, export or idle setpoint for a unit
+template <typename Resource>
+void Dispatch (std::mt19937& random, Resource set) {
+    std::uniform_int_distribution <unsigned int> mode (0, 2);
+    std::uniform_int_distribution <unsigned int> watts (0, 4000);
+    switch (mode (random)) {
+        case 0: set (true, watts (random)); break;
+        case 1: set (false, watts (random)); break;
+        default: set (true, 0); break;
+    }
+}
+
+// Same
+// - unrounded values agree within kTolerance of their size. The fleet does
+// - the arithmetic of the class in the same order, so anything beyond
+// - rounding noise is a change in behaviour.
+const double kTolerance = 1e-9;
+
+bool Same (double lhs, double rhs) {
+    double size = std::max (1.0, std::max (std::fabs (lhs), std::fabs (rhs)));
+    return std::fabs (lhs - rhs) <= kTolerance * size;
+}
+
+// Equivalent
+// - step a small fleet and one object per unit with the same ratings and
+// - setpoints and compare every unit after each step
+bool Equivalent (unsigned int units, unsigned int steps) {
+    tsu::string_map init = Ratings ();
+    ResourceFleet fleet (init, units);
+    fleet.SetThreads (1);
+    std::vector <std::unique_ptr <DistributedEnergyResource>> ders;
+    std::mt19937 random (1);
+    std::uniform_int_distribution <unsigned int> rating (500, 5000);
+    for (unsigned int u = 0; u < units; u++) {
+        ders.emplace_back (new DistributedEnergyResource (init));
+        unsigned int energy = rating (random);
+        unsigned int ramp = rating (random);
+        ders[u]->SetRatedExportEnergy (energy);
+        ders[u]->SetRatedImportEnergy (energy);
+        ders[u]->SetExportRamp (ramp);
+        fleet.SetRatedExportEnergy (u, energy);
+        fleet.SetRatedImportEnergy (u, energy);
+        fleet.SetExportRamp (u, ramp);
+    }
+
+    // 10 minute steps drain and fill units within the run
+    const double delta_time = 600000;
+    for (unsigned int i = 0; i < steps; i++) {
+        for (unsigned int u = 0; u < units; u++) {
+            if ((i + u) % 50 != 0) {
+                continue;
+            }
+            Dispatch (random, [&] (bool import, unsigned int watts) {
+                if (import) {
+                    ders[u]->SetImportWatts (watts);
+                    fleet.SetImportWatts (u, watts);
+                } else {
+                    ders[u]->SetExportWatts (watts);
+                    fleet.SetExportWatts (u, watts);
+                }
+            });
+        }
+        fleet.Loop (delta_time);
+        for (unsigned int u = 0; u < units; u++) {
+            ders[u]->Loop (delta_time);
+            if (!Same (ders[u]->GetUnroundedImportPower (),
+                       fleet.GetImportPower (u))
+                || !Same (ders[u]->GetUnroundedExportPower (),
+                          fleet.GetExportPower (u))
+                || !Same (ders[u]->GetUnroundedImportEnergy (),
+                          fleet.GetImportEnergy (u))
+                || !Same (ders[u]->GetUnroundedExportEnergy (),
+                          fleet.GetExportEnergy (u))) {
+                std::cout << "[ERROR] : unit " << u << " differs at step "
+                    << i << '\n';
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Fleet
+// - fleet with every unit given a setpoint
+std::unique_ptr <ResourceFleet> Fleet (unsigned int units,
+                                       unsigned int threads) {
+    std::unique_ptr <ResourceFleet> fleet (new ResourceFleet (Ratings (),
+                                                              units));
+    fleet->SetThreads (threads);
+    std::mt19937 random (2);
+    for (unsigned int u = 0; u < units; u++) {
+        Dispatch (random, [&] (bool import, unsigned int watts) {
+            if (import) {
+                fleet->SetImportWatts (u, watts);
+            } else {
+                fleet->SetExportWatts (u, watts);
+            }
+        });
+    }
+    return fleet;
+}
+
+// Deterministic
+// - the same fleet run with one thread and with many
+bool Deterministic (unsigned int units, unsigned int steps,
+                    unsigned int threads) {
+    std::unique_ptr <ResourceFleet> one = Fleet (units, 1);
+    std::unique_ptr <ResourceFleet> many = Fleet (units, threads);
+    one->Run (500, steps);
+    many->Run (500, steps);
+    for (unsigned int u = 0; u < units; u++) {
+        if (one->GetImportPower (u) != many->GetImportPower (u)
+            || one->GetImportEnergy (u) != many->GetImportEnergy (u)
+            || one->GetExportPower (u) != many->GetExportPower (u)
+            || one->GetExportEnergy (u) != many->GetExportEnergy (u)) {
+            std::cout << "[ERROR] : unit " << u << " depends on threads\n";
+            return false;
+        }
+    }
+    return one->GetTotalExportEnergy () == many->GetTotalExportEnergy ();
+}
+
+}  // namespace
+
+int main (int argc, char** argv) {
+    unsigned int units = argc > 1 ? std::stoul (argv[1]) : 1000000;
+    unsigned int steps = argc > 2 ? std::stoul (argv[2]) : 1000;
+    unsigned int threads = argc > 3 ? std::stoul (argv[3]) : 0;
+
+    bool equivalent = Equivalent (2000, 500);
+    bool deterministic = Deterministic (100000, 101, 7);
+    std::cout << "equivalent to DistributedEnergyResource:\t"
+        << (equivalent ? "yes" : "no") << '\n'
+        << "independent of thread count:\t"
+        << (deterministic ? "yes" : "no") << '\n';
+
+    // one object per unit as the baseline, on a smaller fleet
+    unsigned int object_units = std::min (units, 100000u);
+    std::vector <std::unique_ptr <DistributedEnergyResource>> ders;
+    for (unsigned int u = 0; u < object_units; u++) {
+        ders.emplace_back (new DistributedEnergyResource (Ratings ()));
+        ders[u]->SetExportWatts (2000);
+    }
+    unsigned int object_steps = 100;
+    clock::time_point start = clock::now ();
+    for (unsigned int i = 0; i < object_steps; i++) {
+        for (auto& der : ders) {
+            der->Loop (500);
+        }
+    }
+    std::chrono::duration <double> elapsed = clock::now () - start;
+    double objects = object_units * double (object_steps) / elapsed.count ();
+
+    std::unique_ptr <ResourceFleet> fleet = Fleet (units, threads);
+    start = clock::now ();
+    fleet->Run (500, steps);
+    elapsed = clock::now () - start;
+    double batched = units * double (steps) / elapsed.count ();
+
+    std::cout << "units " << units << ", steps " << steps << '\n'
+        << "objects:\t" << objects << " unit steps/s\n"
+        << "fleet:\t" << batched << " unit steps/s\n"
+        << "fleet import power (W):\t" << fleet->GetTotalImportPower () << '\n'
+        << "fleet export power (W):\t" << fleet->GetTotalExportPower () << '\n'
+        << "fleet import energy (Wh):\t" << fleet->GetTotalImportEnergy ()
+        << '\n'
+        << "fleet export energy (Wh):\t" << fleet->GetTotalExportEnergy ()
+        << '\n';
+    return equivalent && deterministic ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,209 @@
+// Load Test
+// - end to end poll test on loopback. Every simulated device is a
+// - SunSpecServer on its own port serving a DistributedEnergyResource that
+// - is stepped and published every 100 ms. A Poller with the given number
+// - of worker threads polls the devices back to back, its callback records
+// - the latency of every poll, and the test reports polls per second and
+// - the poll latency percentiles as json.
+// - Usage:
+//  load_test [smdx directory] [devices] [seconds] [threads] [first port]
+//            [json file]
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+
+#include "DistributedEnergyResource.hpp"
+#include "SunSpecServer.h"
+#include "SunSpecCatalog.h"
+#include "Poller.h"
+#include "tsu.h"
+#include "Report.h"
+
+namespace {
+
+typedef std::chrono::steady_clock clock;
+
+// Device
+// - simulated device and the latencies of its polls, a device is only
+// - polled by one worker at a time so its latencies need no lock
+struct Device {
+    std::unique_ptr <DistributedEnergyResource> der;
+    std::unique_ptr <SunSpecServer> server;
+    std::vector <double> latency;
+};
+
+tsu::string_map Ratings () {
+    tsu::string_map init;
+    init["ExportPower"] = "3000";
+    init["ExportEnergy"] = "20000";
+    init["ExportRamp"] = "1000";
+    init["ImportPower"] = "3000";
+    init["ImportEnergy"] = "20000";
+    init["ImportRamp"] = "1000";
+    init["IdleLosses"] = "20";
+    return init;
+}
+
+double Percentile (const std::vector <double>& sorted, double fraction) {
+    if (sorted.empty ()) {
+        return 0;
+    }
+    size_t index = fraction * (sorted.size () - 1);
+    return sorted[index];
+}
+
+// Totals
+// - polls and failures of every device so far
+void Totals (Poller* poller, unsigned long* polls, unsigned long* failures) {
+    *polls = 0;
+    *failures = 0;
+    for (auto& status : poller->GetStatus ()) {
+        *polls += status.polls;
+        *failures += status.failures;
+    }
+}
+
+}  // namespace
+
+int main (int argc, char** argv) {
+    std::string smdx = argc > 1 ? argv[1] : "../data/models/smdx";
+    unsigned int count = argc > 2 ? std::stoul (argv[2]) : 16;
+    unsigned int seconds = argc > 3 ? std::stoul (argv[3]) : 10;
+    unsigned int threads = argc > 4 ? std::stoul (argv[4]) : 4;
+    unsigned int port = argc > 5 ? std::stoul (argv[5]) : 15020;
+    std::string output = argc > 6 ? argv[6] : "loadtest.json";
+    threads = std::max (1u, std::min (threads, count));
+
+    SunSpecCatalog::Instance ().SetPath (smdx);
+
+    // devices report every model they find, keep the setup quiet
+    std::streambuf* console = std::cout.rdbuf (NULL);
+    std::vector <Device> devices (count);
+    tsu::string_map settings;
+    tsu::string_map common;
+    tsu::string_map empty;
+    common["Mn"] = "BESS";
+    common["Md"] = "load_test";
+    for (unsigned int i = 0; i < count; i++) {
+        Device& device = devices[i];
+        device.der.reset (new DistributedEnergyResource (Ratings ()));
+        device.der->SetExportWatts (1000 + i);
+        settings["port"] = std::to_string (port + i);
+        device.server.reset (new SunSpecServer (settings));
+        common["SN"] = std::to_string (i);
+        device.server->AddModel (1, common);
+        device.server->AddModel (802, empty);
+        device.server->AddModel (124, empty);
+        if (!device.server->Start ()) {
+            std::cout.rdbuf (console);
+            std::cout << "[ERROR] : unable to serve port " << port + i << '\n';
+            return EXIT_FAILURE;
+        }
+        device.server->Publish (device.der.get ());
+    }
+
+    // the resources keep changing while they are polled
+    std::atomic <bool> running (true);
+    std::thread resources ([&] () {
+        while (running) {
+            std::this_thread::sleep_for (std::chrono::milliseconds (100));
+            for (auto& device : devices) {
+                device.der->Loop (100);
+                device.server->Publish (device.der.get ());
+            }
+        }
+    });
+
+    // a period of 0 polls every device again as soon as a worker is free
+    tsu::string_map pool;
+    pool["threads"] = std::to_string (threads);
+    Poller poller (pool);
+    std::atomic <bool> recording (false);
+    poller.SetCallback ([&] (const std::string& name, Modbus*, double ms) {
+        if (recording) {
+            devices[std::stoul (name)].latency.push_back (ms);
+        }
+    });
+    tsu::string_map client;
+    client["ip"] = "127.0.0.1";
+    client["smdx_key"] = "1850954613";
+    client["timeout"] = "1000";
+    client["period"] = "0";
+    for (unsigned int i = 0; i < count; i++) {
+        client["port"] = std::to_string (port + i);
+        poller.AddDevice (std::to_string (i), client);
+    }
+    poller.Start ();
+
+    // discovery is not part of the measurement
+    clock::time_point deadline = clock::now () + std::chrono::seconds (10);
+    unsigned int connected = 0;
+    while (connected < count && clock::now () < deadline) {
+        std::this_thread::sleep_for (std::chrono::milliseconds (10));
+        connected = 0;
+        for (auto& status : poller.GetStatus ()) {
+            connected += status.connected ? 1 : 0;
+        }
+    }
+    std::cout.rdbuf (console);
+    if (connected < count) {
+        std::cout << "[ERROR] : " << count - connected
+            << " devices did not connect\n";
+    }
+
+    unsigned long requests = 0;
+    for (auto& device : devices) {
+        requests -= device.server->GetRequests ();
+    }
+    unsigned long polls_before;
+    unsigned long failures_before;
+    Totals (&poller, &polls_before, &failures_before);
+    clock::time_point start = clock::now ();
+    recording = true;
+
+    std::this_thread::sleep_for (std::chrono::seconds (seconds));
+
+    recording = false;
+    std::chrono::duration <double> elapsed = clock::now () - start;
+    unsigned long polls;
+    unsigned long failed;
+    Totals (&poller, &polls, &failed);
+    polls -= polls_before;
+    failed -= failures_before;
+    for (auto& device : devices) {
+        requests += device.server->GetRequests ();
+    }
+    poller.Stop ();
+    running = false;
+    resources.join ();
+
+    std::vector <double> all;
+    for (auto& device : devices) {
+        all.insert (all.end (), device.latency.begin (), device.latency.end ());
+        device.server->Stop ();
+    }
+    std::sort (all.begin (), all.end ());
+
+    Report report ("load_test");
+    report.Add ("poll", {{"devices", double (count)},
+                         {"threads", double (threads)},
+                         {"connected", double (connected)},
+                         {"seconds", elapsed.count ()},
+                         {"polls", double (polls)},
+                         {"failures", double (failed)},
+                         {"polls_per_s", polls / elapsed.count ()},
+                         {"requests_per_s", requests / elapsed.count ()},
+                         {"p50_ms", Percentile (all, 0.5)},
+                         {"p99_ms", Percentile (all, 0.99)},
+                         {"p999_ms", Percentile (all, 0.999)},
+                         {"max_ms", all.empty () ? 0 : all.back ()}});
+    return report.Write (output) && failed == 0 && connected == count
+           ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,124 @@
+// Logger Benchmark
+// - compares the synchronous logger this project used to have, which
+// - opened, appended and closed the log file for every record, with the
+// - ring buffer backed Logger. Each producer thread logs the same kind of
+// - line Modbus logs on a failed read.
+// - Usage:
+//  logger_bench [threads] [records per thread] [directory]
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+
+#include "Logger.h"
+#include "LogWriter.h"
+#include "tsu.h"
+
+namespace {
+
+// Legacy Logger
+// - the previous Logger, kept here as the baseline
+class LegacyLogger {
+public:
+    LegacyLogger (const std::string& directory, const std::string& context)
+        : directory_(directory), context_(context) {
+        msg_ = tsu::GetDateTime () + '\t';
+    }
+
+    ~LegacyLogger () {
+        std::string file_name = directory_ + "legacy_" + context_
+            + "_" + tsu::GetDate () + ".log";
+        std::ofstream output_file (file_name, std::ios_base::app);
+        if (output_file.is_open ()) {
+            output_file << msg_ << '\n';
+        }
+        output_file.close ();
+    }
+
+    template <typename T>
+    LegacyLogger& operator << (T rhs) {
+        std::stringstream ss;
+        ss << rhs;
+        msg_ += ss.str ();
+        return *this;
+    }
+
+private:
+    std::string directory_;
+    std::string context_;
+    std::string msg_;
+};
+
+typedef std::chrono::steady_clock clock;
+
+// Run
+// - start the producers and return the records per second
+template <typename Producer>
+double Run (unsigned int threads, unsigned int records, Producer producer) {
+    clock::time_point start = clock::now ();
+    std::vector <std::thread> pool;
+    for (unsigned int i = 0; i < threads; i++) {
+        pool.emplace_back (producer, i, records);
+    }
+    for (auto& thread : pool) {
+        thread.join ();
+    }
+    std::chrono::duration <double> elapsed = clock::now () - start;
+    return threads * records / elapsed.count ();
+}
+
+}  // namespace
+
+int main (int argc, char** argv) {
+    unsigned int threads = argc > 1 ? std::stoul (argv[1]) : 4;
+    unsigned int records = argc > 2 ? std::stoul (argv[2]) : 20000;
+    std::string directory = argc > 3 ? argv[3] : "/tmp/";
+    if (directory.back () != '/') {
+        directory += '/';
+    }
+
+    tsu::string_map init;
+    init["directory"] = directory;
+    init["device"] = "bench";
+    init["overflow"] = "block";
+    init["capacity"] = "65536";
+    LogWriter& writer = LogWriter::Instance ();
+    writer.Configure (init);
+
+    const void* context_ptr = &init;
+
+    double legacy = Run (threads, records,
+        [&] (unsigned int id, unsigned int count) {
+            for (unsigned int i = 0; i < count; i++) {
+                LegacyLogger (directory, "ERROR") << context_ptr << "\t"
+                    << "Connection timed out\tthread " << id << " poll " << i;
+            }
+        });
+
+    // producers only pay for the push, the writer catches up on flush
+    clock::time_point start = clock::now ();
+    double pushed = Run (threads, records,
+        [&] (unsigned int id, unsigned int count) {
+            for (unsigned int i = 0; i < count; i++) {
+                Logger("ERROR") << context_ptr << "\t"
+                    << "Connection timed out\tthread " << id << " poll " << i;
+            }
+        });
+    writer.Flush ();
+    std::chrono::duration <double> elapsed = clock::now () - start;
+    double written = threads * records / elapsed.count ();
+    writer.Stop ();
+
+    std::cout << "threads " << threads << ", records per thread " << records
+        << '\n'
+        << "legacy logger:\t" << legacy << " records/s\n"
+        << "async producers:\t" << pushed << " records/s\n"
+        << "async written:\t" << written << " records/s\n"
+        << "dropped:\t" << writer.GetDropped () << '\n';
+    return EXIT_SUCCESS;
+}
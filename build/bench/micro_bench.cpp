@@ -0,0 +1,252 @@
+// Micro Benchmark
+// - times the parsing and encoding paths of the project: the SunSpec block
+// - conversions of every model in the smdx directory, the configuration and
+// - csv readers of tsu.h and the Logger. Results are printed and written as
+// - json.
+// - Usage:
+//  micro_bench [smdx directory] [config file] [json file]
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+#include <dirent.h>
+
+#include "SunSpecModel.h"
+#include "SunSpecCatalog.h"
+#include "Logger.h"
+#include "LogWriter.h"
+#include "tsu.h"
+#include "Report.h"
+
+namespace {
+
+typedef std::chrono::steady_clock clock;
+
+// keeps results alive so the optimizer can not drop the timed work
+volatile size_t sink;
+
+// Measure
+// - run the operation in growing batches until a batch takes min_seconds,
+// - returns nanoseconds per operation of that batch
+template <typename Operation>
+double Measure (double min_seconds, Operation operation) {
+    for (unsigned long batch = 1; ; batch *= 2) {
+        clock::time_point start = clock::now ();
+        for (unsigned long i = 0; i < batch; i++) {
+            operation ();
+        }
+        std::chrono::duration <double> elapsed = clock::now () - start;
+        if (elapsed.count () >= min_seconds) {
+            return elapsed.count () * 1e9 / batch;
+        }
+    }
+}
+
+Report::fields PerOperation (double ns) {
+    return {{"ns_per_op", ns}, {"ops_per_s", 1e9 / ns}};
+}
+
+// Model Files
+// - did of every smdx_<did>.xml file in the directory, the manifest does
+// - not list every model
+std::vector <unsigned int> ModelFiles (const std::string& directory) {
+    std::vector <unsigned int> dids;
+    DIR* dir = opendir (directory.c_str ());
+    if (dir == NULL) {
+        std::cerr << "[ERROR] : unable to open " << directory << '\n';
+        return dids;
+    }
+    while (dirent* entry = readdir (dir)) {
+        unsigned int did;
+        int length = 0;
+        if (std::sscanf (entry->d_name, "smdx_%u%n", &did, &length) == 1
+            && std::string (entry->d_name + length) == ".xml") {
+            dids.push_back (did);
+        }
+    }
+    closedir (dir);
+    std::sort (dids.begin (), dids.end ());
+    return dids;
+}  // end Model Files
+
+// Fill Block
+// - register pattern with small scale factors (-2..2) in the sunssf
+// - registers, so scaled points decode to ordinary values. Returns false
+// - if a point of the model still decodes to infinity.
+bool FillBlock (const SunSpecModel& model, std::vector <uint16_t>* block) {
+    for (unsigned int i = 0; i < block->size (); i++) {
+        (*block)[i] = (i * 7919) & 0x7FFF;
+    }
+    const std::vector <SunSpecModel::Point>& points = model.GetPoints ();
+    for (unsigned int i = 0; i < points.size (); i++) {
+        if (points[i].type == SunSpecModel::PointType::SUNSSF) {
+            (*block)[points[i].offset] = static_cast <uint16_t> (
+                static_cast <int16_t> (i % 5) - 2
+            );
+        }
+    }
+
+    SunSpecModel::Values values = model.NewValues ();
+    model.Decode (block->data (), block->size (), &values);
+    for (unsigned int i = 0; i < values.number.size (); i++) {
+        if (std::isinf (values.number[i])) {
+            std::cerr << "[ERROR] : model " << model.did_ << " point "
+                << model.GetPointName (i) << " decodes to inf\n";
+            return false;
+        }
+    }
+    return true;
+}  // end Fill Block
+
+// Models
+// - BlockToPoints and PointsToBlock for every smdx model, with a block
+// - filled by FillBlock so every implemented point carries a value
+bool Models (const std::string& smdx, Report* report) {
+    std::vector <unsigned int> dids = ModelFiles (smdx);
+
+    // the model constructor reports every model it finds
+    std::streambuf* console = std::cout.rdbuf (NULL);
+    std::vector <SunSpecModel> models;
+    for (unsigned int did : dids) {
+        try {
+            models.push_back (SunSpecModel (did, 0));
+        } catch (const std::exception& error) {
+            std::cerr << "[ERROR] : model " << did << " " << error.what ()
+                << '\n';
+        }
+    }
+    std::cout.rdbuf (console);
+
+    bool finite = true;
+    double to_points_total = 0;
+    double to_block_total = 0;
+    for (auto& model : models) {
+        std::vector <uint16_t> block (model.GetLength ());
+        finite = FillBlock (model, &block) && finite;
+        std::map <std::string, std::string> points;
+
+        double to_points = Measure (0.02, [&] () {
+            points = model.BlockToPoints (block);
+            sink = points.size ();
+        });
+        double to_block = Measure (0.02, [&] () {
+            sink = model.PointsToBlock (points).size ();
+        });
+        to_points_total += to_points;
+        to_block_total += to_block;
+
+        std::string did = std::to_string (model.did_);
+        Report::fields fields = PerOperation (to_points);
+        fields.push_back ({"registers", double (block.size ())});
+        report->Add ("BlockToPoints/" + did, fields);
+        fields = PerOperation (to_block);
+        fields.push_back ({"registers", double (block.size ())});
+        report->Add ("PointsToBlock/" + did, fields);
+    }
+
+    // one pass over every model
+    report->Add ("BlockToPoints/all", {{"models", double (models.size ())},
+                                       {"ns_per_pass", to_points_total}});
+    report->Add ("PointsToBlock/all", {{"models", double (models.size ())},
+                                       {"ns_per_pass", to_block_total}});
+    return finite;
+}  // end Models
+
+// Files
+// - the configuration file and a generated csv file
+void Files (const std::string& config_file, Report* report) {
+    report->Add ("MapConfigFile", PerOperation (Measure (0.2, [&] () {
+        sink = tsu::MapConfigFile (config_file).size ();
+    })));
+
+    const unsigned int rows = 1000;
+    const unsigned int columns = 8;
+    std::string csv_file = "/tmp/micro_bench.csv";
+    std::string line;
+    {
+        std::ofstream csv (csv_file);
+        for (unsigned int row = 0; row < rows; row++) {
+            line.clear ();
+            for (unsigned int column = 0; column < columns; column++) {
+                line += (column > 0 ? "," : "")
+                        + std::to_string (row * columns + column);
+            }
+            csv << line << '\n';
+        }
+    }
+
+    Report::fields fields = PerOperation (Measure (0.2, [&] () {
+        sink = tsu::FileToMatrix (csv_file, ',', columns).size ();
+    }));
+    fields.push_back ({"rows", double (rows)});
+    report->Add ("FileToMatrix", fields);
+    std::remove (csv_file.c_str ());
+
+    fields = PerOperation (Measure (0.2, [&] () {
+        sink = tsu::SplitString (line, ',').size ();
+    }));
+    fields.push_back ({"items", double (columns)});
+    report->Add ("SplitString", fields);
+}  // end Files
+
+// Logs
+// - records per second from several producers until they are on disk
+void Logs (Report* report) {
+    const unsigned int threads = 4;
+    const unsigned int records = 50000;
+    tsu::string_map init;
+    init["directory"] = "/tmp/";
+    init["device"] = "micro_bench";
+    init["overflow"] = "block";
+    init["capacity"] = "65536";
+    LogWriter& writer = LogWriter::Instance ();
+    writer.Configure (init);
+
+    clock::time_point start = clock::now ();
+    std::vector <std::thread> pool;
+    for (unsigned int id = 0; id < threads; id++) {
+        pool.emplace_back ([id, records] () {
+            for (unsigned int i = 0; i < records; i++) {
+                Logger("BENCH") << "Connection timed out\tthread " << id
+                    << " poll " << i;
+            }
+        });
+    }
+    for (auto& thread : pool) {
+        thread.join ();
+    }
+    writer.Flush ();
+    std::chrono::duration <double> elapsed = clock::now () - start;
+    writer.Stop ();
+
+    report->Add ("Logger", {{"threads", double (threads)},
+                            {"records_per_s",
+                             threads * records / elapsed.count ()},
+                            {"dropped", double (writer.GetDropped ())}});
+    std::remove (("/tmp/micro_bench_BENCH_" + tsu::GetDate () + ".log")
+                 .c_str ());
+}  // end Logs
+
+}  // namespace
+
+int main (int argc, char** argv) {
+    std::string smdx = argc > 1 ? argv[1] : "../data/models/smdx";
+    std::string config_file = argc > 2 ? argv[2] : "../data/config.ini";
+    std::string output = argc > 3 ? argv[3] : "bench.json";
+
+    SunSpecCatalog::Instance ().SetPath (smdx);
+    Report report ("micro_bench");
+    bool finite = Models (smdx, &report);
+    Files (config_file, &report);
+    Logs (&report);
+    return report.Write (output) && finite ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -15,7 +15,8 @@ DistributedEnergyResource::DistributedEnergyResource (
     import_energy_(0),
     export_watts_(0),
     import_watts_(0),
-    delta_time_(0) {
+    delta_seconds_(0),
+    delta_hours_(0) {
     //ctor
 }
 
@@ -93,6 +94,12 @@ unsigned int DistributedEnergyResource::GetRatedExportPower () {
     return rated_export_power_;
 }  // end Get Rated Export Power
 
+// Get Rated Export Energy
+// - get the watt-hour value available to export to the grid
+unsigned int DistributedEnergyResource::GetRatedExportEnergy () {
+    return rated_export_energy_;
+}  // end Get Rated Export Energy
+
 // Get Export Power
 // - get the watt value available to export to the grid
 unsigned int DistributedEnergyResource::GetExportPower () {
@@ -119,6 +126,12 @@ unsigned int DistributedEnergyResource::GetRatedImportPower () {
     return rated_import_power_;
 }  // end Rated Import Power
 
+// Get Rated Import Energy
+// - get the watt-hour value available to import from the grid
+unsigned int DistributedEnergyResource::GetRatedImportEnergy () {
+    return rated_import_energy_;
+}  // end Get Rated Import Energy
+
 // Get Import Power
 // - get the watt value available to import from the grid
 unsigned int DistributedEnergyResource::GetImportPower () {
@@ -145,12 +158,29 @@ unsigned int DistributedEnergyResource::GetIdleLosses () {
     return idle_losses_;
 }  // end Get Idle Losses
 
+// Get Unrounded State
+// - the dynamic properties before they are truncated to whole units
+double DistributedEnergyResource::GetUnroundedExportPower () {
+    return export_power_;
+}
+
+double DistributedEnergyResource::GetUnroundedExportEnergy () {
+    return export_energy_;
+}
+
+double DistributedEnergyResource::GetUnroundedImportPower () {
+    return import_power_;
+}
+
+double DistributedEnergyResource::GetUnroundedImportEnergy () {
+    return import_energy_;
+}  // end Get Unrounded State
+
 // Import Power
 // - called by control loop if import power is set
 // - assume loss is factored into import power
 void DistributedEnergyResource::ImportPower () {
-    float seconds = delta_time_ / 1000;
-    float watts = import_ramp_ * seconds;
+    double watts = import_ramp_ * delta_seconds_;
 
     // regulate import power
     if (import_power_ + watts < import_watts_) {
@@ -160,7 +190,7 @@ void DistributedEnergyResource::ImportPower () {
     }
 
     // regulate energy
-    float hours = seconds / (60*60);
+    double hours = delta_hours_;
     if (import_energy_ - import_power_ > 0) {
         // area under the linear function
         import_energy_ -= (import_power_*hours + watts*hours/2);
@@ -176,8 +206,7 @@ void DistributedEnergyResource::ImportPower () {
 // - called by control loop if export power is set
 // - assume loss is factored into export power
 void DistributedEnergyResource::ExportPower () {
-    float seconds = delta_time_ / 1000;
-    float watts = export_ramp_ * seconds;
+    double watts = export_ramp_ * delta_seconds_;
 
     // regulate import power
     if (export_power_ + watts < export_watts_) {
@@ -187,7 +216,7 @@ void DistributedEnergyResource::ExportPower () {
     }
 
     // regulate energy
-    float hours = seconds / (60*60);
+    double hours = delta_hours_;
     if (export_energy_ - export_power_ > 0) {
         // area under the linear function
         export_energy_ -= (export_power_*hours + watts*hours/2);
@@ -202,9 +231,7 @@ void DistributedEnergyResource::ExportPower () {
 // Idle Loss
 // - update energy available based on energy lost
 void DistributedEnergyResource::IdleLoss () {
-    float seconds = delta_time_ / 1000;
-    float hours = seconds / (60*60);
-    float energy_loss = idle_losses_ * hours;
+    double energy_loss = idle_losses_ * delta_hours_;
 
     if (import_energy_ + energy_loss < rated_import_energy_) {
         import_energy_ += energy_loss;
@@ -217,8 +244,10 @@ void DistributedEnergyResource::IdleLoss () {
 
 // Control
 // - check state of import / export power properties from main loop on a timer
-void DistributedEnergyResource::Loop (float delta_time) {
-    delta_time_ = delta_time;
+// - delta_time is the milliseconds since the previous loop
+void DistributedEnergyResource::Loop (double delta_time) {
+    delta_seconds_ = delta_time / 1000;
+    delta_hours_ = delta_seconds_ / (60*60);
 
     if (import_watts_ > 0) {
         DistributedEnergyResource::ImportPower ();
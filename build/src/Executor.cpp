@@ -0,0 +1,153 @@
+#include <algorithm>
+
+#include "include/Executor.h"
+
+namespace {
+
+// runs kept for the execution time percentiles
+const size_t kWindow = 1024;
+
+// Percentile
+// - nearest rank percentile of an unsorted copy
+double Percentile (std::vector <double> samples, double percent) {
+    if (samples.empty ()) {
+        return 0;
+    }
+    size_t rank = static_cast <size_t> (percent / 100 * (samples.size () - 1));
+    std::nth_element (samples.begin (), samples.begin () + rank, samples.end ());
+    return samples[rank];
+}
+
+}  // namespace
+
+const std::vector <double> Executor::kJitterBins = {
+    10, 100, 1000, 10000, 100000
+};
+
+Executor::Executor () : running_(false) {
+}
+
+Executor::~Executor () {
+    Executor::Stop ();
+}
+
+// Add Task
+// - tasks added after Start begin with the next Start
+void Executor::AddTask (const std::string& name,
+                        clock::duration period,
+                        task function) {
+    std::unique_ptr <Task> added (new Task);
+    added->name = name;
+    added->period = period;
+    added->function = function;
+    added->runs = 0;
+    added->missed = 0;
+    added->jitter.assign (kJitterBins.size () + 1, 0);
+    added->jitter_max_us = 0;
+    added->exec_ms.reserve (kWindow);
+    added->exec_max_ms = 0;
+
+    std::lock_guard <std::mutex> lock (mutex_);
+    tasks_.push_back (std::move (added));
+}  // end Add Task
+
+void Executor::Start () {
+    std::lock_guard <std::mutex> lock (mutex_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    for (auto& added : tasks_) {
+        threads_.emplace_back (&Executor::Run, this, added.get ());
+    }
+}  // end Start
+
+void Executor::Stop () {
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        running_ = false;
+        stop_.notify_all ();
+    }
+    for (auto& thread : threads_) {
+        thread.join ();
+    }
+    threads_.clear ();
+}  // end Stop
+
+std::vector <Executor::TaskStatus> Executor::GetStatus () {
+    std::vector <TaskStatus> status;
+    std::lock_guard <std::mutex> lock (mutex_);
+    for (auto& task : tasks_) {
+        std::lock_guard <std::mutex> task_lock (task->mutex);
+        std::chrono::duration <double, std::milli> period = task->period;
+        status.push_back ({
+            task->name,
+            period.count (),
+            task->runs,
+            task->missed,
+            task->jitter,
+            task->jitter_max_us,
+            Percentile (task->exec_ms, 50),
+            Percentile (task->exec_ms, 99),
+            task->exec_max_ms
+        });
+    }
+    return status;
+}  // end Get Status
+
+// Run
+// - deadline k is start + k periods. The wait is on the absolute deadline
+// - so time spent running the task or oversleeping is not carried into the
+// - next period. Stop interrupts the wait.
+void Executor::Run (Task* task) {
+    clock::time_point deadline = clock::now ();
+    clock::time_point last = deadline;
+    std::unique_lock <std::mutex> lock (mutex_);
+    while (running_) {
+        if (stop_.wait_until (lock, deadline, [this] { return !running_; })) {
+            break;
+        }
+        lock.unlock ();
+
+        clock::time_point wake = clock::now ();
+        std::chrono::duration <double, std::milli> delta = wake - last;
+        last = wake;
+        task->function (delta.count ());
+        clock::time_point done = clock::now ();
+
+        std::chrono::duration <double, std::micro> jitter = wake - deadline;
+        std::chrono::duration <double, std::milli> exec = done - wake;
+
+        // skip the deadlines the task ran past
+        unsigned long missed = 0;
+        deadline += task->period;
+        if (done > deadline) {
+            missed = (done - deadline) / task->period + 1;
+            deadline += missed * task->period;
+        }
+        Executor::Record (task, jitter.count (), exec.count (), missed);
+
+        lock.lock ();
+    }
+}  // end Run
+
+void Executor::Record (Task* task,
+                       double jitter_us,
+                       double exec_ms,
+                       unsigned long missed) {
+    size_t bin = std::upper_bound (kJitterBins.begin (),
+                                   kJitterBins.end (),
+                                   jitter_us) - kJitterBins.begin ();
+
+    std::lock_guard <std::mutex> lock (task->mutex);
+    task->jitter[bin]++;
+    task->jitter_max_us = std::max (task->jitter_max_us, jitter_us);
+    if (task->exec_ms.size () < kWindow) {
+        task->exec_ms.push_back (exec_ms);
+    } else {
+        task->exec_ms[task->runs % kWindow] = exec_ms;
+    }
+    task->exec_max_ms = std::max (task->exec_max_ms, exec_ms);
+    task->missed += missed;
+    task->runs++;
+}  // end Record
@@ -0,0 +1,282 @@
+#include <iostream>
+
+#include "include/LogWriter.h"
+
+namespace {
+
+// records written before the open files are flushed
+const size_t kBatch = 256;
+
+}  // namespace
+
+LogWriter& LogWriter::Instance () {
+    static LogWriter instance;
+    return instance;
+}  // end Instance
+
+LogWriter::LogWriter ()
+    : mask_(0),
+      head_(0),
+      tail_(0),
+      dropped_(0),
+      dropped_total_(0),
+      running_(false),
+      written_(0),
+      directory_("../../LOGS/"),
+      device_("test"),
+      overflow_(Overflow::DROP),
+      interval_(100),
+      reopen_(false),
+      time_cached_(-1) {
+    LogWriter::Resize (4096);
+}
+
+LogWriter::~LogWriter () {
+    LogWriter::Stop ();
+}
+
+// Configure
+// - optional [Logger] settings. The capacity can only change before the
+// - first record is logged, so configure the logger before starting other
+// - threads.
+void LogWriter::Configure (tsu::string_map& init) {
+    std::lock_guard <std::mutex> lock (mutex_);
+    if (!init["directory"].empty ()) {
+        directory_ = init["directory"];
+        if (directory_.back () != '/') {
+            directory_ += '/';
+        }
+        reopen_ = true;
+    }
+    if (!init["device"].empty ()) {
+        device_ = init["device"];
+        reopen_ = true;
+    }
+    if (init["overflow"] == "block") {
+        overflow_ = Overflow::BLOCK;
+    } else if (init["overflow"] == "drop") {
+        overflow_ = Overflow::DROP;
+    } else if (!init["overflow"].empty ()) {
+        std::cout << "[ERROR] : unknown log overflow policy "
+            << init["overflow"] << '\n';
+    }
+    if (!init["interval"].empty ()) {
+        interval_ = std::chrono::milliseconds (stoul (init["interval"]));
+    }
+    if (!init["capacity"].empty ()) {
+        if (thread_.joinable ()) {
+            std::cout << "[ERROR] : log capacity set after logging started\n";
+        } else {
+            LogWriter::Resize (stoul (init["capacity"]));
+        }
+    }
+}  // end Configure
+
+// Push
+// - claim the next free slot and publish the record in it. Returns false
+// - if the record was dropped.
+bool LogWriter::Push (Record&& record) {
+    std::call_once (started_, &LogWriter::Start, this);
+
+    size_t position = head_.load (std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        if (!running_.load (std::memory_order_relaxed)) {
+            return false;
+        }
+        slot = &slots_[position & mask_];
+        size_t sequence = slot->sequence.load (std::memory_order_acquire);
+        intptr_t difference = static_cast <intptr_t> (sequence)
+                              - static_cast <intptr_t> (position);
+        if (difference == 0) {
+            if (head_.compare_exchange_weak (position, position + 1,
+                                             std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            // full
+            if (overflow_ == Overflow::DROP) {
+                dropped_.fetch_add (1, std::memory_order_relaxed);
+                dropped_total_.fetch_add (1, std::memory_order_relaxed);
+                return false;
+            }
+            wake_.notify_one ();
+            std::this_thread::yield ();
+            position = head_.load (std::memory_order_relaxed);
+        } else {
+            // another producer took the slot
+            position = head_.load (std::memory_order_relaxed);
+        }
+    }
+
+    slot->record = std::move (record);
+    slot->sequence.store (position + 1, std::memory_order_release);
+
+    // the writer wakes on its own interval unless the ring fills up
+    if (position - tail_.load (std::memory_order_relaxed) >= mask_ / 2) {
+        wake_.notify_one ();
+    }
+    return true;
+}  // end Push
+
+// Flush
+// - wait until every record pushed before the call is in its file
+void LogWriter::Flush () {
+    size_t target = head_.load ();
+    std::unique_lock <std::mutex> lock (mutex_);
+    if (!running_) {
+        return;
+    }
+    wake_.notify_one ();
+    flushed_.wait (lock, [this, target] {
+        return written_ >= target || !running_;
+    });
+}  // end Flush
+
+// Stop
+// - the writer drains the ring before it exits
+void LogWriter::Stop () {
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        running_ = false;
+        wake_.notify_one ();
+    }
+    if (thread_.joinable ()) {
+        thread_.join ();
+    }
+}  // end Stop
+
+// Get Dropped
+// - records dropped since the writer was created
+unsigned long LogWriter::GetDropped () {
+    return dropped_total_.load ();
+}
+
+void LogWriter::Start () {
+    std::lock_guard <std::mutex> lock (mutex_);
+    running_ = true;
+    thread_ = std::thread (&LogWriter::Writer, this);
+}  // end Start
+
+// Resize
+// - the capacity is rounded up to a power of two so positions wrap with a
+// - mask. Only safe before the writer starts.
+void LogWriter::Resize (size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    slots_.reset (new Slot[size]);
+    for (size_t i = 0; i < size; i++) {
+        slots_[i].sequence.store (i, std::memory_order_relaxed);
+    }
+    mask_ = size - 1;
+    head_ = 0;
+    tail_ = 0;
+}  // end Resize
+
+// Pop
+// - writer thread only, take the oldest published record
+bool LogWriter::Pop (Record* record) {
+    size_t position = tail_.load (std::memory_order_relaxed);
+    Slot& slot = slots_[position & mask_];
+    size_t sequence = slot.sequence.load (std::memory_order_acquire);
+    if (sequence != position + 1) {
+        return false;
+    }
+    *record = std::move (slot.record);
+    slot.sequence.store (position + mask_ + 1, std::memory_order_release);
+    tail_.store (position + 1, std::memory_order_relaxed);
+    return true;
+}  // end Pop
+
+// Writer
+// - write records in batches and flush the files after each batch. Sleeps
+// - for the configured interval when the ring is empty.
+void LogWriter::Writer () {
+    Record record;
+    std::unique_lock <std::mutex> lock (mutex_);
+    while (true) {
+        lock.unlock ();
+        if (reopen_.exchange (false)) {
+            files_.clear ();
+        }
+
+        size_t count = 0;
+        while (count < kBatch && LogWriter::Pop (&record)) {
+            LogWriter::Write (record);
+            count++;
+        }
+        unsigned long dropped = dropped_.exchange (0);
+        if (dropped > 0) {
+            LogWriter::Write ({
+                clock::now (),
+                "ERROR",
+                "logger\t" + std::to_string (dropped) + " records dropped"
+            });
+        }
+        if (count > 0 || dropped > 0) {
+            for (auto& file : files_) {
+                file.second->stream.flush ();
+            }
+        }
+
+        lock.lock ();
+        written_ += count;
+        flushed_.notify_all ();
+        if (count == kBatch) {
+            continue;
+        } else if (!running_ && tail_ == head_) {
+            break;
+        }
+        wake_.wait_for (lock, interval_);
+    }
+    files_.clear ();
+}  // end Writer
+
+void LogWriter::Write (const Record& record) {
+    const std::string& time = LogWriter::FormatTime (record.time);
+    LogFile* file = LogWriter::GetFile (record.context, time.substr (0, 10));
+    if (file->stream.is_open ()) {
+        file->stream << time << '\t' << record.message << '\n';
+    }
+}  // end Write
+
+// Get File
+// - files stay open until the date rolls over. A file that failed to open
+// - is not retried until then either.
+LogWriter::LogFile* LogWriter::GetFile (const std::string& context,
+                                        const std::string& date) {
+    std::unique_ptr <LogFile>& file = files_[context];
+    if (file && file->date == date) {
+        return file.get ();
+    }
+
+    std::string name;
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        name = directory_ + device_ + "_" + context + "_" + date + ".log";
+    }
+    file.reset (new LogFile);
+    file->date = date;
+    file->stream.open (name, std::ios_base::app);
+    if (!file->stream.is_open ()) {
+        std::cout << "[ERROR] : " << name << ": cannot open log file\n";
+    }
+    return file.get ();
+}  // end Get File
+
+// Format Time
+// - local time as "%F %T", records of the same second share the string
+const std::string& LogWriter::FormatTime (const clock::time_point& time) {
+    std::time_t seconds = clock::to_time_t (time);
+    if (seconds != time_cached_) {
+        struct tm ts;
+        localtime_r (&seconds, &ts);
+        char buf[32];
+        strftime (buf, sizeof (buf), "%F %T", &ts);
+        time_text_ = buf;
+        time_cached_ = seconds;
+    }
+    return time_text_;
+}  // end Format Time
@@ -1,25 +1,47 @@
 #include <iostream>
 #include <string>
+#include <algorithm>
+#include <stdexcept>
 
 #include "include/Modbus.h"
 #include "include/Logger.h"
 
-Modbus::Modbus (tsu::string_map& init) {
+namespace {
+
+// SunSpec register map constants
+// - every sunspec device starts with the "SunS" marker at one of the base
+// - addresses, followed by model headers (id, length) until the end model.
+const uint32_t kSunSpecMarker = 0x53756e53;
+const unsigned int kBaseAddresses[] = {40000, 50000, 0};
+const unsigned int kHeaderLength = 2;
+const uint16_t kEndModel = 0xFFFF;
+const unsigned int kMaxModels = 256;
+
+unsigned int Transactions (const unsigned int length) {
+    return (length + MODBUS_MAX_READ_REGISTERS - 1) / MODBUS_MAX_READ_REGISTERS;
+}
+
+}  // namespace
+
+Modbus::Modbus (tsu::string_map& init)
+    : connected_(false), image_offset_(0), dirty_count_(0) {
     // convert init map data
     const char* ip = init["ip"].c_str();
     int port = std::stoi(init["port"]);
 
-    // create modbus context pointer and connect to device at
-    // given ip address and port number.
+    // create modbus context pointer for the device at the given ip address
+    // and port number, the response timeout is optional (ms).
     context_ptr_ = modbus_new_tcp(ip, port);
-    if (modbus_connect(context_ptr_) == -1) {
-        std::cout << "[ERROR] : " << modbus_strerror(errno) << '\n';
-        Logger("ERROR") << ip << "/" << port << "\t" << modbus_strerror(errno);
+    if (!init["timeout"].empty ()) {
+        unsigned int timeout = stoul(init["timeout"]);
+        modbus_set_response_timeout(context_ptr_,
+                                    timeout / 1000,
+                                    (timeout % 1000) * 1000);
     }
 
-    // read modbus registers for sunspec blocks
+    // connect and read modbus registers for sunspec blocks
     sunspec_key_ = stoul(init["smdx_key"]);
-    Modbus::Querry ();
+    Modbus::Connect ();
 }
 
 Modbus::~Modbus () {
@@ -28,45 +50,327 @@ Modbus::~Modbus () {
     modbus_free(context_ptr_);
 }
 
+// Connect
+// - connect to the device and querry its models if they are not known yet,
+// - the connection is dropped when the models could not be found.
+bool Modbus::Connect () {
+    if (modbus_connect(context_ptr_) == -1) {
+        std::cout << "[ERROR] : " << modbus_strerror(errno) << '\n';
+        Logger("ERROR") << context_ptr_ << "\t" << modbus_strerror(errno);
+        connected_ = false;
+        return false;
+    }
+    connected_ = true;
+    if (models_.empty () && !Modbus::Querry ()) {
+        Modbus::Close ();
+        return false;
+    }
+    return true;
+}  // end Connect
+
+// Close
+// - drop the connection, the next Connect opens a new socket
+void Modbus::Close () {
+    modbus_close(context_ptr_);
+    connected_ = false;
+}  // end Close
+
+bool Modbus::IsConnected () {
+    return connected_;
+}
+
 // Querry
 // - Read all available registers to find sunspec compliant blocks.
-// - The first step is to read the first register and see if the modbus
-// - device is a sunspec complient device.
-// - Then traverse register array and find sunspec DID values and create a
-// - sunspec model.
-void Modbus::Querry () {
-    unsigned int id_offset = 0;
+// - The first step is to find the base address holding the sunspec marker.
+// - Then walk the model headers (id, length) until the end model and create
+// - a sunspec model for each one. The poll plan is built from the result.
+// - A walk that does not reach the end model is a failed discovery and
+// - leaves no models.
+bool Modbus::Querry () {
+    std::vector <SunSpecModel> models;
+    bool found = false;
 
     // the true sunspec key is a 32 bit number so I hacked the config to
-    // assigned the value to check and if it isn't the actual sunspec key it 
+    // assigned the value to check and if it isn't the actual sunspec key it
     // will be consided the smdx number.
+    unsigned int base;
     if (sunspec_key_ < 100000) {
-        SunSpecModel model(sunspec_key_, id_offset);
-        models_.push_back (model);
+        Modbus::AddModel (sunspec_key_, 0, 0, &models);
+        found = !models.empty ();
+    } else if (!Modbus::FindBase (&base)) {
+        std::cout << "[ERROR] : SunSpec marker not found" << std::endl;
+        Logger("ERROR") << context_ptr_ << "\tSunSpec marker not found";
     } else {
-        // the sunspec key 
-        uint16_t sunspec_id[2];
+        unsigned int address = base + kHeaderLength;
+        for (unsigned int i = 0; i < kMaxModels; i++) {
+            uint16_t header[kHeaderLength];
+            if (!Modbus::ReadRegisters (address, kHeaderLength, header)) {
+                break;
+            }
+            if (header[0] == kEndModel) {
+                found = true;
+                break;
+            }
+            // the device length defines the chain, an empty model is skipped
+            // rather than read with the smdx length
+            if (header[1] == 0) {
+                std::cout << "[ERROR] : model " << header[0]
+                    << " has length 0" << '\n';
+                Logger("ERROR") << context_ptr_ << "\tmodel " << header[0]
+                    << " has length 0";
+            } else {
+                Modbus::AddModel (header[0], address + kHeaderLength,
+                                  header[1], &models);
+            }
+            address += kHeaderLength + header[1];
+        }
+        if (!found) {
+            std::cout << "[ERROR] : SunSpec end model not found" << std::endl;
+            Logger("ERROR") << context_ptr_ << "	SunSpec end model not found";
+        }
+    }
+    if (!found) {
+        models.clear ();
+    }
+
+    // writers may be using the current models
+    std::lock_guard <std::mutex> lock (mutex_);
+    models_.swap (models);
+    Modbus::BuildPlan ();
+    return found;
+}
+
+// Find Base
+// - check each sunspec base address for the marker
+bool Modbus::FindBase (unsigned int* base) {
+    for (unsigned int address : kBaseAddresses) {
+        uint16_t marker[2];
+        if (Modbus::ReadRegisters (address, 2, marker)
+            && MODBUS_GET_INT32_FROM_INT16(marker, 0) == kSunSpecMarker) {
+            *base = address;
+            return true;
+        }
+    }
+    return false;
+}  // end Find Base
+
+// Add Model
+// - models without an smdx file are skipped, a length of zero keeps the
+// - length of the smdx model (only for a model given by the smdx key, the
+// - models of a chain always have the length their header reports).
+void Modbus::AddModel (const unsigned int did,
+                       const unsigned int offset,
+                       const unsigned int length,
+                       std::vector <SunSpecModel>* models) {
+    try {
+        SunSpecModel model(did, offset);
+        if (length > 0 && length != model.GetLength ()) {
+            model.SetLength (length);
+        }
+        models->push_back (model);
+    } catch (const std::exception& error) {
+        std::cout << "[ERROR] : model " << did << " " << error.what () << '\n';
+        Logger("ERROR") << context_ptr_ << "\tmodel " << did << " unsupported";
+    }
+}  // end Add Model
+
+// Plan Reads
+// - merge models into one span when reading them together, including the
+// - registers between them (model headers, skipped models), takes no more
+// - transactions than reading them apart, then split each span into the
+// - fewest transactions allowed by the modbus read limit.
+std::vector <Modbus::ReadRequest> Modbus::PlanReads (
+    const std::vector <SunSpecModel>& models) {
+    std::vector <ReadRequest> spans;
+    for (const SunSpecModel& model : models) {
+        ReadRequest span = {model.offset_, model.length_};
+        if (span.length > 0) {
+            spans.push_back (span);
+        }
+    }
+    std::sort (spans.begin (), spans.end (),
+               [] (const ReadRequest& lhs, const ReadRequest& rhs) {
+                   return lhs.offset < rhs.offset;
+               });
+
+    std::vector <ReadRequest> merged;
+    for (const ReadRequest& span : spans) {
+        if (!merged.empty ()) {
+            ReadRequest& last = merged.back ();
+            unsigned int end = last.offset + last.length;
+            unsigned int span_end = std::max (end, span.offset + span.length);
+            unsigned int combined = span_end - last.offset;
+            if (Transactions (combined) <= Transactions (last.length)
+                                           + Transactions (span.length)) {
+                last.length = combined;
+                continue;
+            }
+        }
+        merged.push_back (span);
+    }
+
+    std::vector <ReadRequest> plan;
+    for (const ReadRequest& span : merged) {
+        for (unsigned int i = 0; i < span.length;
+             i += MODBUS_MAX_READ_REGISTERS) {
+            ReadRequest request;
+            request.offset = span.offset + i;
+            request.length = std::min <unsigned int> (
+                MODBUS_MAX_READ_REGISTERS, span.length - i
+            );
+            plan.push_back (request);
+        }
+    }
+    return plan;
+}  // end Plan Reads
+
+// Build Plan
+// - plan the reads, size the register image to cover them and record which
+// - requests each model depends on. Caller must hold the mutex.
+void Modbus::BuildPlan () {
+    read_plan_ = Modbus::PlanReads (models_);
+    image_.clear ();
+    values_.clear ();
+    model_requests_.clear ();
+    image_offset_ = 0;
+
+    if (!read_plan_.empty ()) {
+        image_offset_ = read_plan_.front ().offset;
+        const ReadRequest& last = read_plan_.back ();
+        image_.assign (last.offset + last.length - image_offset_, 0);
+    }
+
+    for (SunSpecModel& model : models_) {
+        unsigned int first = read_plan_.size ();
+        unsigned int last = 0;
+        unsigned int end = model.offset_ + model.length_;
+        for (unsigned int i = 0; i < read_plan_.size (); i++) {
+            const ReadRequest& request = read_plan_[i];
+            if (request.offset < end
+                && model.offset_ < request.offset + request.length) {
+                first = std::min (first, i);
+                last = i;
+            }
+        }
+        model_requests_.push_back (first);
+        model_requests_.push_back (last);
+        values_.push_back (model.NewValues ());
+    }
+    request_status_.assign (read_plan_.size (), false);
+    model_selected_.assign (models_.size (), false);
+    model_read_.assign (models_.size (), false);
+    read_buffer_.assign (image_.size (), 0);
+    pending_.assign (image_.size (), 0);
+    dirty_.assign (image_.size (), false);
+    dirty_count_ = 0;
+}  // end Build Plan
+
+// Poll Models
+// - read every request of the plan into the register image and decode
+// - each model whose registers were all read. Returns false if a read
+// - failed, the reads after it are skipped and models that depend on them
+// - keep their previous values.
+bool Modbus::PollModels () {
+    model_selected_.assign (models_.size (), true);
+    return Modbus::PollSelected ();
+}  // end Poll Models
+
+// Poll Models
+// - same as above for a subset of models, only the requests covering
+// - them are read.
+bool Modbus::PollModels (const std::vector <unsigned int>& dids) {
+    for (unsigned int i = 0; i < models_.size (); i++) {
+        model_selected_[i] = std::find (dids.begin (), dids.end (),
+                                        models_[i].did_) != dids.end ();
+    }
+    return Modbus::PollSelected ();
+}  // end Poll Models
+
+bool Modbus::PollSelected () {
+    std::vector <bool>& status = request_status_;
+    std::vector <bool>& needed = request_needed_;
+    needed.assign (read_plan_.size (), false);
+    for (unsigned int i = 0; i < models_.size (); i++) {
+        if (!model_selected_[i]) {
+            continue;
+        }
+        for (unsigned int r = model_requests_[2*i];
+             r <= model_requests_[2*i + 1] && r < needed.size (); r++) {
+            needed[r] = true;
+        }
+    }
+
+    // stop at the first failed read, the device is unlikely to answer the
+    // rest and the caller backs off before trying again
+    bool success = true;
+    for (unsigned int i = 0; i < read_plan_.size (); i++) {
+        if (!needed[i]) {
+            continue;
+        }
+        if (!success) {
+            status[i] = false;
+            continue;
+        }
+        const ReadRequest& request = read_plan_[i];
+        uint16_t* buffer = read_buffer_.data () + (request.offset - image_offset_);
+        status[i] = Modbus::ReadRegisters (request.offset,
+                                           request.length,
+                                           buffer);
+        success = status[i];
+    }
 
-        // TODO (TS): sunspec states the holding register start can be
-        // - 30, 40, or 50,000.
-        // - 40000 is the preferece starting location
-        unsigned int id_offset = 0;
-        ReadRegisters(id_offset, 2, sunspec_id);
+    // the image is shared with writers which take their scale factors from it
+    std::lock_guard <std::mutex> lock (mutex_);
+    for (unsigned int i = 0; i < read_plan_.size (); i++) {
+        if (needed[i] && status[i]) {
+            const ReadRequest& request = read_plan_[i];
+            unsigned int index = request.offset - image_offset_;
+            std::copy (read_buffer_.begin () + index,
+                       read_buffer_.begin () + index + request.length,
+                       image_.begin () + index);
+        }
+    }
 
-        // DEGUG
-        std::cout 
-            << MODBUS_GET_INT32_FROM_INT16(sunspec_id,id_offset) 
-            << std::endl;
+    for (unsigned int i = 0; i < models_.size (); i++) {
+        unsigned int first = model_requests_[2*i];
+        unsigned int last = model_requests_[2*i + 1];
+        bool valid = model_selected_[i] && first <= last;
+        for (unsigned int r = first; valid && r <= last; r++) {
+            valid = status[r];
+        }
+        if (valid) {
+            const SunSpecModel& model = models_[i];
+            models_[i].Decode (&image_[model.offset_ - image_offset_],
+                               model.length_,
+                               &values_[i]);
+            model_read_[i] = true;
+        }
+    }
+    return success;
+}
 
-        SunSpecModel model(1, 2);
-        models_.push_back (model);
+// Get Values
+// - the decoded values of a model from the last poll
+const SunSpecModel::Values* Modbus::GetValues (const unsigned int did) {
+    auto model_it = std::find(models_.begin(), models_.end(), did);
+    if (model_it == models_.end()) {
+        return nullptr;
     }
+    return &values_[model_it - models_.begin ()];
+}  // end Get Values
+
+const std::vector <Modbus::ReadRequest>& Modbus::GetReadPlan () {
+    return read_plan_;
+}
+
+const std::vector <SunSpecModel>& Modbus::GetModels () {
+    return models_;
 }
 
 // Read Registers
 // - the register array is passed to the function as a pointer so the
 // - modbus method call can operate on them.
-void Modbus::ReadRegisters (unsigned int offset,
+bool Modbus::ReadRegisters (unsigned int offset,
                             unsigned int length,
                             uint16_t *reg_ptr) {
     int status = modbus_read_registers (context_ptr_,
@@ -76,13 +380,31 @@ void Modbus::ReadRegisters (unsigned int offset,
     if (status == -1) {
         std::cout << "[ERROR] : " << modbus_strerror(errno) << '\n';
         Logger("ERROR") << context_ptr_ << "\t" << modbus_strerror(errno);
+        return false;
+    }
+    return true;
+}
 
+// Read Block
+// - read a block of any length using as many transactions as required
+bool Modbus::ReadBlock (unsigned int offset,
+                        unsigned int length,
+                        uint16_t *reg_ptr) {
+    for (unsigned int i = 0; i < length; i += MODBUS_MAX_READ_REGISTERS) {
+        unsigned int count = std::min <unsigned int> (
+            MODBUS_MAX_READ_REGISTERS, length - i
+        );
+        if (!Modbus::ReadRegisters (offset + i, count, reg_ptr + i)) {
+            return false;
+        }
     }
+    return true;
 }
 
 // Write Registers
-// - the registers to write are passed by reference to reduce memory
-void Modbus::WriteRegisters (unsigned int offset,
+// - the registers to write are passed by reference to reduce memory, errno
+// - is left as libmodbus set it so callers can tell a refusal apart.
+bool Modbus::WriteRegisters (unsigned int offset,
                              unsigned int length,
                              const uint16_t *reg_ptr) {
     int status = modbus_write_registers (context_ptr_,
@@ -90,13 +412,18 @@ void Modbus::WriteRegisters (unsigned int offset,
                                          length,
                                          reg_ptr);
     if (status == -1) {
-        std::cout << "[ERROR] : " << modbus_strerror(errno) << '\n';
-        Logger("ERROR") << context_ptr_ << "\t" << modbus_strerror(errno);
+        int error = errno;
+        std::cout << "[ERROR] : " << modbus_strerror(error) << '\n';
+        Logger("ERROR") << context_ptr_ << "\t" << modbus_strerror(error);
+        errno = error;
+        return false;
     }
+    return true;
 }
 
 // Read Model
-// 
+// - read a single model and convert it to sunspec points, the map is empty
+// - when the model is unknown or could not be read.
 tsu::string_map Modbus::ReadModel (const unsigned int did) {
     // search through models looking for the specified did number
     auto model_it = std::find(models_.begin(), models_.end(), did);
@@ -108,13 +435,10 @@ tsu::string_map Modbus::ReadModel (const unsigned int did) {
         unsigned int length = (*model_it).GetLength ();
 
         // read model registers
-        uint16_t registers[length];
-        Modbus::ReadRegisters(offset, length, registers);
-
-        // store array as vector for easier transport
         std::vector <uint16_t> block (length,0);
-        for (unsigned int i = 0; i < length; i++) {
-            block[i] = registers[i];
+        if (!Modbus::ReadBlock(offset, length, block.data ())) {
+            tsu::string_map blank;
+            return blank;
         }
 
         // convert modbus block to sunspec points 
@@ -126,30 +450,166 @@ tsu::string_map Modbus::ReadModel (const unsigned int did) {
     }
 }
 
+// Write Model
+// - queue every point in the map and write them, points that are not in
+// - the map are left untouched on the device.
 void Modbus::WriteModel (const unsigned int did, tsu::string_map model) {
-    // search through models looking for the specified did number
+    for (auto& point : model) {
+        Modbus::SetPoint (did, point.first, point.second);
+    }
+    Modbus::Flush ();
+}
+
+// Set Point
+// - encode a point into the pending write image and mark its registers
+// - dirty. Setting the same point again before a flush replaces the value.
+bool Modbus::SetPoint (const unsigned int did,
+                       const std::string& id,
+                       const double value) {
+    return Modbus::SetPoint (did, id, value, "");
+}
+
+bool Modbus::SetPoint (const unsigned int did,
+                       const std::string& id,
+                       const std::string& value) {
+    std::lock_guard <std::mutex> lock (mutex_);
     auto model_it = std::find(models_.begin(), models_.end(), did);
+    if (model_it == models_.end()) {
+        return false;
+    }
+    int index = (*model_it).FindPoint (id);
+    if (index < 0) {
+        return false;
+    }
 
-    // ensure index is within models
-    if (model_it != models_.end()) {
-        // get model properties
-        unsigned int offset = (*model_it).GetOffset ();
-        unsigned int length = (*model_it).GetLength ();
+    double number;
+    int32_t symbol;
+    std::string text;
+    if (!(*model_it).ParsePoint (index, value, &number, &symbol, &text)) {
+        return false;
+    }
+    return Modbus::StagePoint (*model_it, index, number, text);
+}
+
+bool Modbus::SetPoint (const unsigned int did,
+                       const std::string& id,
+                       const double value,
+                       const std::string& text) {
+    std::lock_guard <std::mutex> lock (mutex_);
+    auto model_it = std::find(models_.begin(), models_.end(), did);
+    if (model_it == models_.end()) {
+        return false;
+    }
+    int index = (*model_it).FindPoint (id);
+    if (index < 0) {
+        return false;
+    }
+    return Modbus::StagePoint (*model_it, index, value, text);
+}
 
-        // convert points to registers
-        std::vector <uint16_t> block = (*model_it).PointsToBlock (model);
+// Stage Point
+// - caller must hold the mutex. Only rw points can be written. Scale
+// - factors come from the last poll, a point scaled by a sunssf register is
+// - refused until its model was read.
+bool Modbus::StagePoint (const SunSpecModel& model,
+                         const unsigned int index,
+                         const double value,
+                         const std::string& text) {
+    const SunSpecModel::Point& point = model.GetPoints ()[index];
+    unsigned int start = model.offset_ + point.offset - image_offset_;
+    if (model.offset_ < image_offset_ || start + point.length > image_.size ()) {
+        return false;
+    }
+    if (!point.writable) {
+        std::cout << "[ERROR] : model " << model.did_ << " point "
+            << model.GetPointName (index) << " is read only" << '\n';
+        Logger("ERROR") << context_ptr_ << "\tmodel " << model.did_
+            << " point " << model.GetPointName (index) << " is read only";
+        return false;
+    }
+    if (point.sf_register >= 0 && !model_read_[&model - models_.data ()]) {
+        std::cout << "[ERROR] : model " << model.did_
+            << " scale factors not read" << '\n';
+        Logger("ERROR") << context_ptr_ << "\tmodel " << model.did_
+            << " scale factors not read";
+        return false;
+    }
 
-        // convert block to register array
-        uint16_t registers[length];
-        for (unsigned int i = 0; i < length; i++) {
-            registers[i] = block[i];
-            std::cout << block[i] << '\n';
+    uint16_t* registers = &pending_[start];
+    const uint16_t* scalers = &image_[model.offset_ - image_offset_];
+    if (!model.EncodePoint (index, value, text, scalers, model.length_,
+                           registers)) {
+        return false;
+    }
+    for (unsigned int i = start; i < start + point.length; i++) {
+        if (!dirty_[i]) {
+            dirty_[i] = true;
+            dirty_count_++;
         }
+    }
+    return true;
+}
 
-        Modbus::WriteRegisters (offset, length, registers);
-    } else {
-        std::cout << "[ERROR]: Model not found" << std::endl;
+// Flush
+// - write the dirty registers, each run of consecutive dirty registers is
+// - one transaction (split at the modbus write limit). Runs lost to a
+// - timeout or a dropped connection are marked dirty again unless they were
+// - set since, and Flush returns false. A run the device refuses with an
+// - exception is logged and dropped, resending it would only be refused
+// - again.
+bool Modbus::Flush () {
+    std::vector <ReadRequest> runs;
+    std::vector <uint16_t> registers;
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        if (dirty_count_ == 0) {
+            return true;
+        }
+        for (unsigned int i = 0; i < dirty_.size (); i++) {
+            if (!dirty_[i]) {
+                continue;
+            }
+            if (runs.empty ()
+                || runs.back ().offset + runs.back ().length != i
+                || runs.back ().length == MODBUS_MAX_WRITE_REGISTERS) {
+                runs.push_back ({i, 0});
+            }
+            runs.back ().length++;
+            registers.push_back (pending_[i]);
+            dirty_[i] = false;
+        }
+        dirty_count_ = 0;
     }
 
+    bool success = true;
+    const uint16_t* data = registers.data ();
+    for (const ReadRequest& run : runs) {
+        if (!Modbus::WriteRegisters (image_offset_ + run.offset,
+                                     run.length, data)) {
+            if (errno >= EMBXILFUN && errno <= EMBXGTAR) {
+                Logger("ERROR") << context_ptr_ << "\twrite of " << run.length
+                    << " registers at " << image_offset_ + run.offset
+                    << " refused";
+                data += run.length;
+                continue;
+            }
+            success = false;
+            std::lock_guard <std::mutex> lock (mutex_);
+            for (unsigned int i = 0; i < run.length; i++) {
+                unsigned int index = run.offset + i;
+                if (index < dirty_.size () && !dirty_[index]) {
+                    pending_[index] = data[i];
+                    dirty_[index] = true;
+                    dirty_count_++;
+                }
+            }
+        }
+        data += run.length;
+    }
+    return success;
 }
 
+bool Modbus::HasPending () {
+    std::lock_guard <std::mutex> lock (mutex_);
+    return dirty_count_ > 0;
+}
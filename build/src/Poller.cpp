@@ -0,0 +1,346 @@
+#include <iostream>
+#include <algorithm>
+
+#include "include/Poller.h"
+#include "include/Logger.h"
+
+namespace {
+
+// Get Unsigned
+// - optional unsigned configuration value
+unsigned int GetUnsigned (tsu::string_map& init,
+                          const std::string& key,
+                          const unsigned int fallback) {
+    if (init[key].empty ()) {
+        return fallback;
+    }
+    return stoul (init[key]);
+}
+
+}  // namespace
+
+Poller::Poller (tsu::string_map& init)
+    : running_(false),
+      thread_count_(GetUnsigned (init, "threads", 4)),
+      host_limit_(GetUnsigned (init, "host_inflight", 0)),
+      retries_(GetUnsigned (init, "retries", 3)),
+      backoff_min_(std::chrono::milliseconds (
+          GetUnsigned (init, "backoff", 1000))),
+      backoff_max_(std::chrono::milliseconds (
+          GetUnsigned (init, "backoff_max", 60000))) {
+    if (thread_count_ == 0) {
+        thread_count_ = 1;
+    }
+}
+
+Poller::~Poller () {
+    Poller::Stop ();
+}
+
+// Add Device
+// - the device section holds the modbus settings plus its poll schedule
+// - period=<ms> polls every model, models=<did>:<ms>,... polls the listed
+// - models at their own rate instead.
+void Poller::AddDevice (const std::string& name, tsu::string_map& init) {
+    std::unique_ptr <Device> device (new Device);
+    device->name = name;
+    device->host = init["ip"];
+    device->init = init;
+    device->next = clock::now ();
+    device->backoff = backoff_min_;
+    device->busy = false;
+    device->pending = false;
+    device->errors = 0;
+    device->status = {name, false, 0, 0, 0, 0, 0};
+
+    if (init["models"].empty ()) {
+        std::chrono::milliseconds period (GetUnsigned (init, "period", 1000));
+        device->schedules.push_back ({0, period, device->next});
+    } else {
+        for (auto& item : tsu::SplitString (init["models"], ',')) {
+            std::vector <std::string> pair = tsu::SplitString (item, ':');
+            if (pair.size () != 2) {
+                std::cout << "[ERROR] : invalid schedule " << item << '\n';
+                continue;
+            }
+            std::chrono::milliseconds period (stoul (pair[1]));
+            device->schedules.push_back (
+                {static_cast <unsigned int> (stoul (pair[0])),
+                 period,
+                 device->next}
+            );
+        }
+    }
+
+    std::lock_guard <std::mutex> lock (mutex_);
+    devices_.push_back (std::move (device));
+    condition_.notify_one ();
+}  // end Add Device
+
+void Poller::SetCallback (callback on_poll) {
+    std::lock_guard <std::mutex> lock (mutex_);
+    on_poll_ = on_poll;
+}
+
+// Set Point
+// - stage a point write on a device, the device is woken to flush it so
+// - setpoints do not wait for the next poll. Writes to the same point
+// - before the flush collapse into one.
+bool Poller::SetPoint (const std::string& name,
+                       const unsigned int did,
+                       const std::string& id,
+                       const double value) {
+    std::lock_guard <std::mutex> lock (mutex_);
+    for (auto& device : devices_) {
+        if (device->name != name) {
+            continue;
+        }
+        if (!device->modbus || !device->modbus->SetPoint (did, id, value)) {
+            return false;
+        }
+        device->pending = true;
+        if (!device->busy && device->modbus->IsConnected ()) {
+            device->next = std::min (device->next, clock::now ());
+            condition_.notify_one ();
+        }
+        return true;
+    }
+    return false;
+}  // end Set Point
+
+// Start
+// - devices connect from the worker threads so a dead device does not
+// - hold up the caller.
+void Poller::Start () {
+    std::lock_guard <std::mutex> lock (mutex_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    for (unsigned int i = 0; i < thread_count_; i++) {
+        threads_.emplace_back (&Poller::Worker, this);
+    }
+}  // end Start
+
+void Poller::Stop () {
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        running_ = false;
+        condition_.notify_all ();
+    }
+    for (auto& thread : threads_) {
+        thread.join ();
+    }
+    threads_.clear ();
+}  // end Stop
+
+std::vector <Poller::DeviceStatus> Poller::GetStatus () {
+    std::lock_guard <std::mutex> lock (mutex_);
+    std::vector <DeviceStatus> status;
+    for (auto& device : devices_) {
+        status.push_back (device->status);
+    }
+    return status;
+}
+
+// Worker
+// - take the device that is due first, poll it without holding the lock
+// - and put it back. Sleep until the next device is due otherwise.
+void Poller::Worker () {
+    std::unique_lock <std::mutex> lock (mutex_);
+    while (running_) {
+        clock::time_point wake;
+        Device* device = Poller::NextDevice (&wake);
+        if (device == nullptr) {
+            if (wake == clock::time_point::max ()) {
+                condition_.wait (lock);
+            } else {
+                condition_.wait_until (lock, wake);
+            }
+            continue;
+        }
+
+        device->busy = true;
+        host_inflight_[device->host]++;
+        lock.unlock ();
+
+        Poller::Service (device);
+
+        lock.lock ();
+        device->busy = false;
+        host_inflight_[device->host]--;
+        if (device->pending && device->modbus
+            && device->modbus->IsConnected ()) {
+            device->next = std::min (device->next, clock::now ());
+        }
+        condition_.notify_all ();
+    }
+}  // end Worker
+
+// Next Device
+// - caller must hold the lock. Returns the idle device that is due first
+// - or sets wake to the time the next one will be due.
+Poller::Device* Poller::NextDevice (clock::time_point* wake) {
+    Device* next = nullptr;
+    for (auto& device : devices_) {
+        if (device->busy
+            || (host_limit_ > 0
+                && host_inflight_[device->host] >= host_limit_)) {
+            continue;
+        }
+        if (next == nullptr || device->next < next->next) {
+            next = device.get ();
+        }
+    }
+
+    if (next == nullptr) {
+        *wake = clock::time_point::max ();
+        return nullptr;
+    } else if (next->next > clock::now ()) {
+        *wake = next->next;
+        return nullptr;
+    }
+    return next;
+}  // end Next Device
+
+// Service
+// - poll the models of a device that are due. Reads that fail several
+// - times in a row close the connection so it is reopened with a backoff.
+void Poller::Service (Device* device) {
+    clock::time_point now = clock::now ();
+    if (!device->modbus || !device->modbus->IsConnected ()) {
+        if (!Poller::Reconnect (device)) {
+            Poller::Backoff (device, now);
+            return;
+        }
+    }
+
+    // setpoints go out before the poll so it reads them back, Flush only
+    // fails on transport errors so refused writes do not count as errors
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        device->pending = false;
+    }
+    bool flushed = device->modbus->Flush ();
+
+    std::vector <unsigned int> dids;
+    bool all = false;
+    for (auto& schedule : device->schedules) {
+        if (schedule.due <= now) {
+            all = all || schedule.did == 0;
+            dids.push_back (schedule.did);
+        }
+    }
+    if (dids.empty ()) {
+        // woken only to write
+        if (!flushed && ++device->errors >= retries_) {
+            Poller::Disconnect (device, now);
+        }
+        Poller::Reschedule (device);
+        return;
+    }
+
+    clock::time_point start = clock::now ();
+    bool success = all ? device->modbus->PollModels ()
+                       : device->modbus->PollModels (dids);
+    std::chrono::duration <double, std::milli> elapsed;
+    elapsed = clock::now () - start;
+
+    callback on_poll;
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        DeviceStatus& status = device->status;
+        status.polls++;
+        status.last_ms = elapsed.count ();
+        status.max_ms = std::max (status.max_ms, status.last_ms);
+        if (!success) {
+            status.failures++;
+        }
+        on_poll = on_poll_;
+    }
+
+    if (success) {
+        device->errors = 0;
+        if (on_poll) {
+            on_poll (device->name, device->modbus.get (), elapsed.count ());
+        }
+    } else if (++device->errors >= retries_) {
+        Poller::Disconnect (device, now);
+        return;
+    }
+
+    // keep the schedule on its original grid unless it fell behind
+    for (auto& schedule : device->schedules) {
+        if (schedule.due <= now) {
+            schedule.due += schedule.period;
+            if (schedule.due <= now) {
+                schedule.due = now + schedule.period;
+            }
+        }
+    }
+    Poller::Reschedule (device);
+}  // end Service
+
+// Reschedule
+// - the device is next due with its earliest model
+void Poller::Reschedule (Device* device) {
+    device->next = clock::time_point::max ();
+    for (auto& schedule : device->schedules) {
+        device->next = std::min (device->next, schedule.due);
+    }
+}  // end Reschedule
+
+// Disconnect
+// - close a device that keeps failing and retry it after the backoff
+void Poller::Disconnect (Device* device, clock::time_point now) {
+    Logger("ERROR") << device->name << "\tclosing after "
+        << device->errors << " failed requests";
+    device->modbus->Close ();
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        device->status.connected = false;
+    }
+    Poller::Backoff (device, now);
+}  // end Disconnect
+
+// Reconnect
+// - the modbus object is created on first use so its blocking connect runs
+// - on a worker thread
+bool Poller::Reconnect (Device* device) {
+    bool reconnect = static_cast <bool> (device->modbus);
+    if (!device->modbus) {
+        // writers look the modbus object up under the lock
+        std::unique_ptr <Modbus> modbus (new Modbus (device->init));
+        std::lock_guard <std::mutex> lock (mutex_);
+        device->modbus = std::move (modbus);
+    } else {
+        device->modbus->Connect ();
+    }
+
+    bool connected = device->modbus->IsConnected ()
+                     && !device->modbus->GetModels ().empty ();
+    if (device->modbus->IsConnected () && !connected) {
+        // connected but the models could not be read, try again later
+        device->modbus->Close ();
+    }
+
+    std::lock_guard <std::mutex> lock (mutex_);
+    device->status.connected = connected;
+    if (connected) {
+        device->status.reconnects += reconnect ? 1 : 0;
+        device->errors = 0;
+        device->backoff = backoff_min_;
+        clock::time_point now = clock::now ();
+        for (auto& schedule : device->schedules) {
+            schedule.due = now;
+        }
+    }
+    return connected;
+}  // end Reconnect
+
+// Backoff
+// - wait before the next connection attempt, doubling up to the maximum
+void Poller::Backoff (Device* device, clock::time_point now) {
+    device->next = now + device->backoff;
+    device->backoff = std::min (device->backoff * 2, backoff_max_);
+}  // end Backoff
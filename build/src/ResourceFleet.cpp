@@ -0,0 +1,303 @@
+#include <thread>
+#include <algorithm>
+
+#include "include/ResourceFleet.h"
+
+namespace {
+
+// units stepped together through every step of a run, small enough for the
+// arrays of a block to stay in cache
+const size_t kBlock = 1024;
+
+// State
+// - dynamic properties of a block of units
+struct State {
+    double* import_power;
+    double* import_energy;
+    double* export_power;
+    double* export_energy;
+};
+
+// Step Units
+// - DistributedEnergyResource::ImportPower, ExportPower and IdleLoss for
+// - count units. All three are computed and the unit's mode selects the
+// - result, so the loop has no branches. The arithmetic is in the same order
+// - as the class so the results are identical.
+// - The new state is written to separate arrays, gcc turns a select that
+// - may keep the old value in place into a conditional store and gives up
+// - on the loop. It also only vectorizes the selects with
+// - -fno-trapping-math, which the benchmark build uses.
+void StepUnits (const size_t count,
+                const double seconds,
+                const double hours,
+                const double* __restrict rated_export_energy,
+                const double* __restrict export_ramp,
+                const double* __restrict rated_import_energy,
+                const double* __restrict import_ramp,
+                const double* __restrict idle_losses,
+                const double* __restrict export_watts,
+                const double* __restrict import_watts,
+                const double* __restrict import_power,
+                const double* __restrict import_energy,
+                const double* __restrict export_power,
+                const double* __restrict export_energy,
+                double* __restrict next_import_power,
+                double* __restrict next_import_energy,
+                double* __restrict next_export_power,
+                double* __restrict next_export_energy) {
+    for (size_t i = 0; i < count; i++) {
+        double ip = import_power[i];
+        double ie = import_energy[i];
+        double ep = export_power[i];
+        double ee = export_energy[i];
+
+        // import power
+        double import_step = import_ramp[i] * seconds;
+        double import_up = ip + import_step;
+        double import_ramped = (import_up < import_watts[i])
+                               ? import_up : import_watts[i];
+        double import_drained = ie - (import_ramped*hours + import_step*hours/2);
+        bool import_ok = ie - import_ramped > 0;
+        double import_ie = import_ok ? import_drained : 0;
+        double import_ee = rated_export_energy[i] - import_ie;
+        double import_ip = import_ok ? import_ramped : 0;
+
+        // export power
+        double export_step = export_ramp[i] * seconds;
+        double export_up = ep + export_step;
+        double export_ramped = (export_up < export_watts[i])
+                               ? export_up : export_watts[i];
+        double export_drained = ee - (export_ramped*hours + export_step*hours/2);
+        bool export_ok = ee - export_ramped > 0;
+        double export_ee = export_ok ? export_drained : 0;
+        double export_ie = rated_import_energy[i] - export_ee;
+        double export_ep = export_ok ? export_ramped : 0;
+
+        // idle loss
+        double energy_loss = idle_losses[i] * hours;
+        double idle_up = ie + energy_loss;
+        double idle_down = ee - energy_loss;
+        double idle_ie = (idle_up < rated_import_energy[i]) ? idle_up : ie;
+        double idle_ee = (idle_down > 0) ? idle_down : ee;
+
+        // import wins over export like in Loop
+        bool importing = import_watts[i] > 0;
+        bool exporting = export_watts[i] > 0;
+        double exporting_ie = exporting ? export_ie : idle_ie;
+        double exporting_ee = exporting ? export_ee : idle_ee;
+        double exporting_ep = exporting ? export_ep : ep;
+        next_import_power[i] = importing ? import_ip : ip;
+        next_import_energy[i] = importing ? import_ie : exporting_ie;
+        next_export_power[i] = importing ? ep : exporting_ep;
+        next_export_energy[i] = importing ? import_ee : exporting_ee;
+    }
+}  // end Step Units
+
+}  // namespace
+
+ResourceFleet::ResourceFleet (tsu::string_map init, const size_t units) :
+    units_(units),
+    threads_(std::max (1u, std::thread::hardware_concurrency ())),
+    rated_export_power_(units, stoul(init["ExportPower"])),
+    rated_export_energy_(units, stoul(init["ExportEnergy"])),
+    export_ramp_(units, stoul(init["ExportRamp"])),
+    rated_import_power_(units, stoul(init["ImportPower"])),
+    rated_import_energy_(units, stoul(init["ImportEnergy"])),
+    import_ramp_(units, stoul(init["ImportRamp"])),
+    idle_losses_(units, stoul(init["IdleLosses"])),
+    export_power_(units, 0),
+    export_energy_(rated_export_energy_),
+    import_power_(units, 0),
+    import_energy_(units, 0),
+    export_watts_(units, 0),
+    import_watts_(units, 0) {
+    //ctor
+}
+
+ResourceFleet::~ResourceFleet () {
+    //dtor
+}
+
+// Set Threads
+// - threads used by Run, 0 uses one per core
+void ResourceFleet::SetThreads (const unsigned int threads) {
+    threads_ = threads;
+    if (threads_ == 0) {
+        threads_ = std::max (1u, std::thread::hardware_concurrency ());
+    }
+}  // end Set Threads
+
+// Loop
+// - one step on the calling thread, a single step is too short to pay for
+// - starting the threads of Run
+void ResourceFleet::Loop (const double delta_time) {
+    ResourceFleet::Steps (0, units_, delta_time / 1000, 1);
+}  // end Loop
+
+// Run
+// - every thread steps its own range of whole blocks through all the steps
+void ResourceFleet::Run (const double delta_time, const unsigned int steps) {
+    double seconds = delta_time / 1000;
+    size_t blocks = (units_ + kBlock - 1) / kBlock;
+    size_t threads = std::min <size_t> (threads_, blocks);
+    if (threads <= 1) {
+        ResourceFleet::Steps (0, units_, seconds, steps);
+        return;
+    }
+
+    std::vector <std::thread> pool;
+    for (size_t i = 0; i < threads; i++) {
+        size_t begin = std::min (units_, blocks * i / threads * kBlock);
+        size_t end = std::min (units_, blocks * (i + 1) / threads * kBlock);
+        pool.emplace_back (&ResourceFleet::Steps, this,
+                           begin, end, seconds, steps);
+    }
+    for (auto& thread : pool) {
+        thread.join ();
+    }
+}  // end Run
+
+// Steps
+// - the block alternates between its arrays and a scratch block each step
+void ResourceFleet::Steps (const size_t begin,
+                           const size_t end,
+                           const double seconds,
+                           const unsigned int steps) {
+    double hours = seconds / (60*60);
+    std::vector <double> scratch (4*kBlock);
+    for (size_t block = begin; block < end; block += kBlock) {
+        size_t count = std::min (end, block + kBlock) - block;
+        State state = {
+            &import_power_[block], &import_energy_[block],
+            &export_power_[block], &export_energy_[block]
+        };
+        State next = {
+            &scratch[0], &scratch[kBlock], &scratch[2*kBlock], &scratch[3*kBlock]
+        };
+        for (unsigned int i = 0; i < steps; i++) {
+            StepUnits (count, seconds, hours,
+                       &rated_export_energy_[block], &export_ramp_[block],
+                       &rated_import_energy_[block], &import_ramp_[block],
+                       &idle_losses_[block], &export_watts_[block],
+                       &import_watts_[block],
+                       state.import_power, state.import_energy,
+                       state.export_power, state.export_energy,
+                       next.import_power, next.import_energy,
+                       next.export_power, next.export_energy);
+            std::swap (state, next);
+        }
+        if (steps % 2 == 1) {
+            std::copy (state.import_power, state.import_power + count,
+                       next.import_power);
+            std::copy (state.import_energy, state.import_energy + count,
+                       next.import_energy);
+            std::copy (state.export_power, state.export_power + count,
+                       next.export_power);
+            std::copy (state.export_energy, state.export_energy + count,
+                       next.export_energy);
+        }
+    }
+}  // end Steps
+
+// Set Export Watts
+// - set the export control property used in the control loop
+void ResourceFleet::SetExportWatts (const size_t unit, unsigned int power) {
+    import_watts_[unit] = 0;
+    import_power_[unit] = 0;
+    if (power > rated_export_power_[unit]) {
+        power = rated_export_power_[unit];
+    }
+    export_watts_[unit] = power;
+}  // end Set Export Watts
+
+// Set Import Watts
+// - set the import control property used in the control loop
+void ResourceFleet::SetImportWatts (const size_t unit, unsigned int power) {
+    export_watts_[unit] = 0;
+    export_power_[unit] = 0;
+    if (power > rated_import_power_[unit]) {
+        power = rated_import_power_[unit];
+    }
+    import_watts_[unit] = power;
+}  // end Set Import Watts
+
+void ResourceFleet::SetRatedExportPower (const size_t unit,
+                                         unsigned int watts) {
+    rated_export_power_[unit] = watts;
+}
+
+void ResourceFleet::SetRatedExportEnergy (const size_t unit,
+                                          unsigned int watt_hours) {
+    rated_export_energy_[unit] = watt_hours;
+}
+
+void ResourceFleet::SetExportRamp (const size_t unit,
+                                   unsigned int watts_per_second) {
+    export_ramp_[unit] = watts_per_second;
+}
+
+void ResourceFleet::SetRatedImportPower (const size_t unit,
+                                         unsigned int watts) {
+    rated_import_power_[unit] = watts;
+}
+
+void ResourceFleet::SetRatedImportEnergy (const size_t unit,
+                                          unsigned int watt_hours) {
+    rated_import_energy_[unit] = watt_hours;
+}
+
+void ResourceFleet::SetImportRamp (const size_t unit,
+                                   unsigned int watts_per_second) {
+    import_ramp_[unit] = watts_per_second;
+}
+
+void ResourceFleet::SetIdleLosses (const size_t unit,
+                                   unsigned int energy_per_hour) {
+    idle_losses_[unit] = energy_per_hour;
+}
+
+size_t ResourceFleet::GetUnits () {
+    return units_;
+}
+
+double ResourceFleet::GetExportPower (const size_t unit) {
+    return export_power_[unit];
+}
+
+double ResourceFleet::GetExportEnergy (const size_t unit) {
+    return export_energy_[unit];
+}
+
+double ResourceFleet::GetImportPower (const size_t unit) {
+    return import_power_[unit];
+}
+
+double ResourceFleet::GetImportEnergy (const size_t unit) {
+    return import_energy_[unit];
+}
+
+double ResourceFleet::GetTotalExportPower () {
+    return ResourceFleet::Total (export_power_);
+}
+
+double ResourceFleet::GetTotalExportEnergy () {
+    return ResourceFleet::Total (export_energy_);
+}
+
+double ResourceFleet::GetTotalImportPower () {
+    return ResourceFleet::Total (import_power_);
+}
+
+double ResourceFleet::GetTotalImportEnergy () {
+    return ResourceFleet::Total (import_energy_);
+}
+
+// Total
+// - summed in unit order whatever the thread count
+double ResourceFleet::Total (const std::vector <double>& property) {
+    double total = 0;
+    for (size_t i = 0; i < units_; i++) {
+        total += property[i];
+    }
+    return total;
+}  // end Total
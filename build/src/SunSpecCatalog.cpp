@@ -0,0 +1,612 @@
+#include <iostream>
+#include <iomanip>  // setfill, setw
+#include <fstream>
+#include <sstream>
+#include <cstdio>   // sscanf
+#include <cstring>  // memcmp, memcpy
+#include <stdexcept>
+#include <algorithm>
+
+// BOOST Libs
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#include <boost/foreach.hpp>
+
+#include "include/SunSpecCatalog.h"
+
+namespace pt = boost::property_tree;
+
+namespace {
+
+// Type Table
+// - smdx type name, point type and default register length
+struct TypeInfo {
+    const char* name;
+    SunSpecModel::PointType type;
+    uint16_t length;
+};
+
+const TypeInfo kTypes[] = {
+    {"int16", SunSpecModel::PointType::INT16, 1},
+    {"uint16", SunSpecModel::PointType::UINT16, 1},
+    {"count", SunSpecModel::PointType::COUNT, 1},
+    {"acc16", SunSpecModel::PointType::ACC16, 1},
+    {"enum16", SunSpecModel::PointType::ENUM16, 1},
+    {"bitfield16", SunSpecModel::PointType::BITFIELD16, 1},
+    {"sunssf", SunSpecModel::PointType::SUNSSF, 1},
+    {"int32", SunSpecModel::PointType::INT32, 2},
+    {"uint32", SunSpecModel::PointType::UINT32, 2},
+    {"acc32", SunSpecModel::PointType::ACC32, 2},
+    {"float32", SunSpecModel::PointType::FLOAT32, 2},
+    {"enum32", SunSpecModel::PointType::ENUM32, 2},
+    {"bitfield32", SunSpecModel::PointType::BITFIELD32, 2},
+    {"ipaddr", SunSpecModel::PointType::IPADDR, 2},
+    {"int64", SunSpecModel::PointType::INT64, 4},
+    {"uint64", SunSpecModel::PointType::UINT64, 4},
+    {"acc64", SunSpecModel::PointType::ACC64, 4},
+    {"string", SunSpecModel::PointType::STRING, 1},
+    {"ipv6addr", SunSpecModel::PointType::IPV6ADDR, 8},
+    {"eui48", SunSpecModel::PointType::EUI48, 4}
+};
+const unsigned int kTypeCount = sizeof(kTypes) / sizeof(kTypes[0]);
+
+// Binary Catalog
+// - header, did index sorted by did, then one record per model.
+// - Every section is 4 byte aligned so a record read into a buffer can be
+// - decoded without parsing. Strings are null terminated offsets into the
+// - record.
+const char kMagic[8] = {'S', 'M', 'D', 'X', 'C', 'A', 'T', '\0'};
+const uint32_t kVersion = 2;
+
+struct CatalogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+};
+
+struct CatalogEntry {
+    uint32_t did;
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct ModelRecord {
+    uint32_t did;
+    uint32_t length;
+    uint32_t fixed_length;
+    uint32_t repeating_length;
+    uint32_t name;
+    uint32_t repeating_name;
+    uint32_t fixed_count;
+    uint32_t repeating_count;
+    uint32_t symbol_count;
+    uint32_t symbol_name_count;
+    uint32_t strings_size;
+};
+
+struct PointRecord {
+    uint32_t id;
+    uint32_t sf;
+    uint8_t type;
+    uint8_t writable;
+    uint16_t offset;
+    uint16_t length;
+    uint16_t padding;
+    uint32_t symbol_begin;
+    uint32_t symbol_end;
+};
+
+// String Table
+// - collects the strings of a record while it is serialized
+class StringTable {
+public:
+    uint32_t Add (const std::string& value) {
+        uint32_t offset = data_.size ();
+        data_.insert (data_.end (), value.begin (), value.end ());
+        data_.push_back ('\0');
+        return offset;
+    };
+
+    const std::vector <char>& Data () {
+        while (data_.size () % 4 != 0) {
+            data_.push_back ('\0');
+        }
+        return data_;
+    };
+
+private:
+    std::vector <char> data_;
+};
+
+template <typename T>
+void Append (std::vector <char>* buffer, const T& value) {
+    const char* bytes = reinterpret_cast <const char*> (&value);
+    buffer->insert (buffer->end (), bytes, bytes + sizeof(T));
+}
+
+// Intern Symbol
+// - symbol names repeat a lot (RESERVED, OFF, ...) so each name is only
+// - stored once per model.
+uint32_t InternSymbol (const std::string& name,
+                       std::map <std::string, uint32_t>* index,
+                       SunSpecModel::Definition* definition) {
+    auto it = index->find (name);
+    if (it != index->end ()) {
+        return it->second;
+    }
+    uint32_t id = definition->symbol_names.size ();
+    definition->symbol_names.push_back (name);
+    (*index)[name] = id;
+    return id;
+}
+
+// Compile Block
+// - convert each point of a block to a definition, pads and unknown types
+// - are skipped because they carry no value.
+void CompileBlock (const pt::ptree& block,
+                   std::map <std::string, uint32_t>* symbol_index,
+                   SunSpecModel::Definition* definition,
+                   std::vector <SunSpecModel::PointDefinition>* points) {
+    BOOST_FOREACH (pt::ptree::value_type const& node, block) {
+        if (node.first != "point") {
+            continue;
+        }
+        const pt::ptree& subtree = node.second;
+        std::string type = subtree.get <std::string> ("<xmlattr>.type", "");
+
+        const TypeInfo* info = nullptr;
+        for (const TypeInfo& candidate : kTypes) {
+            if (type == candidate.name) {
+                info = &candidate;
+                break;
+            }
+        }
+        if (info == nullptr) {
+            continue;
+        }
+
+        SunSpecModel::PointDefinition point;
+        point.id = subtree.get <std::string> ("<xmlattr>.id", "");
+        point.sf = subtree.get <std::string> ("<xmlattr>.sf", "");
+        point.type = info->type;
+        point.writable
+            = subtree.get <std::string> ("<xmlattr>.access", "r") == "rw";
+        point.offset = subtree.get <uint16_t> ("<xmlattr>.offset", 0);
+        point.length = info->length;
+        if (info->type == SunSpecModel::PointType::STRING) {
+            point.length = subtree.get <uint16_t> ("<xmlattr>.len", 1);
+        }
+
+        // collect enum values and bitfield bits
+        point.symbol_begin = definition->symbols.size ();
+        BOOST_FOREACH (pt::ptree::value_type const& symbol, subtree) {
+            if (symbol.first == "symbol") {
+                SunSpecModel::Symbol entry;
+                try {
+                    entry.value = std::stoul (symbol.second.data ());
+                } catch (...) {
+                    continue;
+                }
+                entry.id = InternSymbol (
+                    symbol.second.get <std::string> ("<xmlattr>.id", ""),
+                    symbol_index,
+                    definition
+                );
+                definition->symbols.push_back (entry);
+            }
+        }
+        point.symbol_end = definition->symbols.size ();
+        points->push_back (point);
+    }
+}
+
+}  // namespace
+
+SunSpecCatalog& SunSpecCatalog::Instance () {
+    static SunSpecCatalog catalog;
+    return catalog;
+}
+
+SunSpecCatalog::SunSpecCatalog ()
+    : path_("../data/models/smdx"),
+      binary_size_(0) {
+}
+
+SunSpecCatalog::~SunSpecCatalog () {
+    SunSpecCatalog::CloseBinary ();
+}
+
+// Set Path
+// - directory holding the smdx_NNNNN.xml files
+void SunSpecCatalog::SetPath (const std::string& path) {
+    std::lock_guard <std::mutex> lock (mutex_);
+    path_ = path;
+}  // end Set Path
+
+// Open Binary
+// - open a catalog created by WriteBinary, models found in it are used
+// - instead of parsing their xml file. Only the index is kept in memory,
+// - the record of a model is read from the file when it is first used.
+bool SunSpecCatalog::OpenBinary (const std::string& filename) {
+    SunSpecCatalog::CloseBinary ();
+    std::lock_guard <std::mutex> lock (mutex_);
+
+    binary_.open (filename, std::ios::binary | std::ios::ate);
+    if (!binary_.is_open ()) {
+        std::cout << "[ERROR] : unable to open catalog " << filename << '\n';
+        return false;
+    }
+    binary_size_ = static_cast <size_t> (binary_.tellg ());
+    binary_.seekg (0);
+
+    CatalogHeader header;
+    std::vector <CatalogEntry> entries;
+    bool valid = binary_size_ >= sizeof(header)
+                 && binary_.read (reinterpret_cast <char*> (&header),
+                                  sizeof(header))
+                 && std::memcmp (header.magic, kMagic, sizeof(kMagic)) == 0
+                 && header.version == kVersion
+                 && sizeof(header) + static_cast <size_t> (header.count)
+                    * sizeof(CatalogEntry) <= binary_size_;
+    if (valid) {
+        entries.resize (header.count);
+        valid = static_cast <bool> (binary_.read (
+            reinterpret_cast <char*> (entries.data ()),
+            entries.size () * sizeof(CatalogEntry)
+        ));
+    }
+    if (!valid) {
+        std::cout << "[ERROR] : invalid catalog " << filename << '\n';
+        binary_.close ();
+        return false;
+    }
+
+    for (const CatalogEntry& entry : entries) {
+        index_[entry.did] = std::make_pair (entry.offset, entry.size);
+    }
+    return true;
+}  // end Open Binary
+
+void SunSpecCatalog::CloseBinary () {
+    std::lock_guard <std::mutex> lock (mutex_);
+    binary_.close ();
+    binary_size_ = 0;
+    index_.clear ();
+}
+
+// Get Definition
+// - return the shared definition for a did, loading it on first use
+std::shared_ptr <const SunSpecModel::Definition>
+SunSpecCatalog::GetDefinition (const unsigned int did) {
+    std::lock_guard <std::mutex> lock (mutex_);
+    return SunSpecCatalog::Load (did);
+}  // end Get Definition
+
+// Get Table
+// - return the shared point table of a did expanded for a model length
+std::shared_ptr <const SunSpecModel::Table>
+SunSpecCatalog::GetTable (const unsigned int did, const unsigned int length) {
+    std::lock_guard <std::mutex> lock (mutex_);
+    auto key = std::make_pair (did, length);
+    auto it = tables_.find (key);
+    if (it != tables_.end ()) {
+        return it->second;
+    }
+    std::shared_ptr <const SunSpecModel::Table> table;
+    table = SunSpecModel::Expand (SunSpecCatalog::Load (did), length);
+    tables_[key] = table;
+    return table;
+}  // end Get Table
+
+// Load
+// - caller must hold the mutex
+std::shared_ptr <const SunSpecModel::Definition>
+SunSpecCatalog::Load (const unsigned int did) {
+    auto it = definitions_.find (did);
+    if (it != definitions_.end ()) {
+        return it->second;
+    }
+
+    std::shared_ptr <const SunSpecModel::Definition> definition;
+    definition = SunSpecCatalog::LoadBinary (did);
+    if (!definition) {
+        definition = SunSpecCatalog::LoadXml (did);
+    }
+    definitions_[did] = definition;
+    return definition;
+}  // end Load
+
+// Load Xml
+// - create filename using the base path, then pad the did number and append
+// - to the base path. The sunspec models are provided as xml so that will be
+// - the file type that is appended ot the end of the filename.
+std::shared_ptr <const SunSpecModel::Definition>
+SunSpecCatalog::LoadXml (const unsigned int did) {
+    std::stringstream ss;
+    ss << path_ << "/smdx_";
+    ss << std::setfill ('0') << std::setw(5) << did;
+    ss << ".xml";
+    std::string filename = ss.str();
+
+    pt::ptree smdx;
+    try {
+        pt::xml_parser::read_xml(filename, smdx);
+    } catch (const pt::xml_parser_error& error) {
+        std::cout << "[ERROR] : " << error.what () << '\n';
+        throw std::runtime_error ("SunSpec model not found");
+    }
+
+    std::shared_ptr <SunSpecModel::Definition> definition (
+        new SunSpecModel::Definition
+    );
+    definition->did = smdx.get <unsigned int> (
+        "sunSpecModels.model.<xmlattr>.id", 0
+    );
+    definition->name = smdx.get <std::string> (
+        "sunSpecModels.model.<xmlattr>.name", ""
+    );
+    definition->length = smdx.get <unsigned int> (
+        "sunSpecModels.model.<xmlattr>.len", 0
+    );
+    definition->fixed_length = 0;
+    definition->repeating_length = 0;
+
+    std::map <std::string, uint32_t> symbol_index;
+    BOOST_FOREACH (pt::ptree::value_type const& node,
+                   smdx.get_child ("sunSpecModels.model")) {
+        if (node.first != "block") {
+            continue;
+        }
+        const pt::ptree& block = node.second;
+        std::string type = block.get <std::string> ("<xmlattr>.type", "");
+        unsigned int length = block.get <unsigned int> ("<xmlattr>.len", 0);
+
+        if (type == "repeating") {
+            definition->repeating_name = block.get <std::string> (
+                "<xmlattr>.name", "repeating"
+            );
+            definition->repeating_length = length;
+            CompileBlock (block, &symbol_index, definition.get (),
+                          &definition->repeating);
+        } else {
+            definition->fixed_length = length;
+            CompileBlock (block, &symbol_index, definition.get (),
+                          &definition->fixed);
+        }
+    }
+    return definition;
+}  // end Load Xml
+
+// Load Binary
+// - find the did in the catalog index, read its record and decode it,
+// - returns null when no catalog is open, the did is not in it or its
+// - record is corrupt.
+// - Every count, offset and range is checked against the record first.
+std::shared_ptr <const SunSpecModel::Definition>
+SunSpecCatalog::LoadBinary (const unsigned int did) {
+    auto entry = index_.find (did);
+    if (!binary_.is_open () || entry == index_.end ()) {
+        return nullptr;
+    }
+    uint32_t offset = entry->second.first;
+    uint32_t size = entry->second.second;
+    if (offset % 4 != 0
+        || offset + static_cast <size_t> (size) > binary_size_
+        || size < sizeof(ModelRecord)) {
+        std::cout << "[ERROR] : corrupt catalog record " << did << '\n';
+        return nullptr;
+    }
+
+    // the buffer is allocated with the alignment of any record field
+    std::vector <uint32_t> buffer ((size + 3) / 4);
+    binary_.clear ();
+    binary_.seekg (offset);
+    if (!binary_.read (reinterpret_cast <char*> (buffer.data ()), size)) {
+        std::cout << "[ERROR] : unable to read catalog record " << did << '\n';
+        return nullptr;
+    }
+
+    const uint8_t* record = reinterpret_cast <const uint8_t*> (buffer.data ());
+    const ModelRecord* model = reinterpret_cast <const ModelRecord*> (record);
+    size_t point_count = static_cast <size_t> (model->fixed_count)
+        + model->repeating_count;
+    size_t expected = sizeof(ModelRecord)
+        + point_count * sizeof(PointRecord)
+        + static_cast <size_t> (model->symbol_count)
+            * sizeof(SunSpecModel::Symbol)
+        + static_cast <size_t> (model->symbol_name_count) * sizeof(uint32_t)
+        + model->strings_size;
+    if (expected > size) {
+        std::cout << "[ERROR] : corrupt catalog record " << did << '\n';
+        return nullptr;
+    }
+
+    const PointRecord* points
+        = reinterpret_cast <const PointRecord*> (model + 1);
+    const SunSpecModel::Symbol* symbols
+        = reinterpret_cast <const SunSpecModel::Symbol*> (points + point_count);
+    const uint32_t* symbol_names
+        = reinterpret_cast <const uint32_t*> (symbols + model->symbol_count);
+    const char* strings
+        = reinterpret_cast <const char*> (symbol_names
+                                          + model->symbol_name_count);
+
+    // strings must be null terminated inside the string table
+    size_t strings_size = model->strings_size;
+    auto valid_string = [strings, strings_size] (uint32_t offset) {
+        return offset < strings_size && strings[strings_size - 1] == '\0';
+    };
+    bool valid = valid_string (model->name)
+                 && valid_string (model->repeating_name);
+    for (size_t i = 0; valid && i < point_count; i++) {
+        uint32_t block_length = i < model->fixed_count
+                                ? model->fixed_length
+                                : model->repeating_length;
+        valid = valid_string (points[i].id) && valid_string (points[i].sf)
+                && points[i].offset + points[i].length <= block_length
+                && points[i].type < kTypeCount
+                && points[i].writable <= 1
+                && points[i].symbol_begin <= points[i].symbol_end
+                && points[i].symbol_end <= model->symbol_count;
+    }
+    for (size_t i = 0; valid && i < model->symbol_count; i++) {
+        valid = symbols[i].id < model->symbol_name_count;
+    }
+    for (size_t i = 0; valid && i < model->symbol_name_count; i++) {
+        valid = valid_string (symbol_names[i]);
+    }
+    if (!valid) {
+        std::cout << "[ERROR] : corrupt catalog record " << did << '\n';
+        return nullptr;
+    }
+
+    std::shared_ptr <SunSpecModel::Definition> definition (
+        new SunSpecModel::Definition
+    );
+    definition->did = model->did;
+    definition->length = model->length;
+    definition->fixed_length = model->fixed_length;
+    definition->repeating_length = model->repeating_length;
+    definition->name = strings + model->name;
+    definition->repeating_name = strings + model->repeating_name;
+
+    for (size_t i = 0; i < point_count; i++) {
+        SunSpecModel::PointDefinition point;
+        point.id = strings + points[i].id;
+        point.sf = strings + points[i].sf;
+        point.type = static_cast <SunSpecModel::PointType> (points[i].type);
+        point.writable = points[i].writable != 0;
+        point.offset = points[i].offset;
+        point.length = points[i].length;
+        point.symbol_begin = points[i].symbol_begin;
+        point.symbol_end = points[i].symbol_end;
+        if (i < model->fixed_count) {
+            definition->fixed.push_back (point);
+        } else {
+            definition->repeating.push_back (point);
+        }
+    }
+
+    definition->symbols.assign (symbols, symbols + model->symbol_count);
+    for (size_t i = 0; i < model->symbol_name_count; i++) {
+        definition->symbol_names.push_back (strings + symbol_names[i]);
+    }
+    return definition;
+}  // end Load Binary
+
+// Read Manifest
+// - list the model dids named in manifest.xml of the smdx directory
+std::vector <unsigned int> SunSpecCatalog::ReadManifest () {
+    std::string filename;
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        filename = path_ + "/manifest.xml";
+    }
+
+    pt::ptree manifest;
+    pt::xml_parser::read_xml(filename, manifest);
+
+    std::vector <unsigned int> dids;
+    BOOST_FOREACH (pt::ptree::value_type const& node,
+                   manifest.get_child ("manifest")) {
+        if (node.first != "file") {
+            continue;
+        }
+        std::string name = node.second.get <std::string> ("<xmlattr>.name", "");
+        unsigned int did;
+        if (std::sscanf (name.c_str (), "smdx_%u.xml", &did) == 1) {
+            dids.push_back (did);
+        }
+    }
+    return dids;
+}  // end Read Manifest
+
+// Write Binary
+// - parse the xml of each did and write a catalog that OpenBinary can load
+bool SunSpecCatalog::WriteBinary (const std::string& filename,
+                                  const std::vector <unsigned int>& dids) {
+    std::vector <unsigned int> sorted (dids);
+    std::sort (sorted.begin (), sorted.end ());
+    sorted.erase (std::unique (sorted.begin (), sorted.end ()), sorted.end ());
+
+    std::vector <CatalogEntry> entries;
+    std::vector <char> records;
+    size_t base = sizeof(CatalogHeader) + sorted.size () * sizeof(CatalogEntry);
+
+    for (unsigned int did : sorted) {
+        std::shared_ptr <const SunSpecModel::Definition> definition;
+        {
+            std::lock_guard <std::mutex> lock (mutex_);
+            definition = SunSpecCatalog::LoadXml (did);
+        }
+
+        StringTable strings;
+        ModelRecord model;
+        model.did = definition->did;
+        model.length = definition->length;
+        model.fixed_length = definition->fixed_length;
+        model.repeating_length = definition->repeating_length;
+        model.name = strings.Add (definition->name);
+        model.repeating_name = strings.Add (definition->repeating_name);
+        model.fixed_count = definition->fixed.size ();
+        model.repeating_count = definition->repeating.size ();
+        model.symbol_count = definition->symbols.size ();
+        model.symbol_name_count = definition->symbol_names.size ();
+
+        std::vector <char> body;
+        std::vector <const SunSpecModel::PointDefinition*> points;
+        for (auto& point : definition->fixed) {
+            points.push_back (&point);
+        }
+        for (auto& point : definition->repeating) {
+            points.push_back (&point);
+        }
+        for (auto point : points) {
+            PointRecord entry;
+            std::memset (&entry, 0, sizeof(entry));
+            entry.id = strings.Add (point->id);
+            entry.sf = strings.Add (point->sf);
+            entry.type = static_cast <uint8_t> (point->type);
+            entry.writable = point->writable ? 1 : 0;
+            entry.offset = point->offset;
+            entry.length = point->length;
+            entry.symbol_begin = point->symbol_begin;
+            entry.symbol_end = point->symbol_end;
+            Append (&body, entry);
+        }
+        for (auto& symbol : definition->symbols) {
+            Append (&body, symbol);
+        }
+        for (auto& name : definition->symbol_names) {
+            Append (&body, strings.Add (name));
+        }
+        const std::vector <char>& data = strings.Data ();
+        model.strings_size = data.size ();
+
+        CatalogEntry entry;
+        entry.did = did;
+        entry.offset = base + records.size ();
+        Append (&records, model);
+        records.insert (records.end (), body.begin (), body.end ());
+        records.insert (records.end (), data.begin (), data.end ());
+        entry.size = base + records.size () - entry.offset;
+        entries.push_back (entry);
+    }
+
+    CatalogHeader header;
+    std::memcpy (header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.count = entries.size ();
+
+    std::ofstream output_file (filename, std::ios::binary | std::ios::trunc);
+    if (!output_file.is_open ()) {
+        std::cout << "[ERROR] : unable to write catalog " << filename << '\n';
+        return false;
+    }
+    output_file.write (reinterpret_cast <const char*> (&header),
+                       sizeof(header));
+    output_file.write (reinterpret_cast <const char*> (entries.data ()),
+                       entries.size () * sizeof(CatalogEntry));
+    output_file.write (records.data (), records.size ());
+    return output_file.good ();
+}  // end Write Binary
@@ -1,398 +1,783 @@
 #include <iostream>
+#include <sstream>
 #include <cmath>
-#include <cctype>  // isdigit
-#include <bitset>
+#include <cstring>  // memcpy
+#include <limits>
+#include <stdexcept>
 
 #include "include/SunSpecModel.h"
+#include "include/SunSpecCatalog.h"
+
+namespace {
+
+// sunssf value of a scale factor that is not implemented
+const uint16_t kNotImplemented = 0x8000;
+
+// Power Of Ten
+// - sunssf values are small signed exponents so keep a table for the
+// - common range and only fall back to pow() outside of it.
+double PowerOfTen (const int exponent) {
+    static const double kPowers[] = {
+        1e-10, 1e-9, 1e-8, 1e-7, 1e-6, 1e-5, 1e-4, 1e-3, 1e-2, 1e-1,
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10
+    };
+    if (exponent >= -10 && exponent <= 10) {
+        return kPowers[exponent + 10];
+    }
+    return std::pow(10.0, exponent);
+}
+
+// converter registers to larger values
+// - modbus registers are big endian words, the first register holds the
+// - most significant word.
+uint32_t GetUINT32 (const uint16_t* block, const unsigned int index) {
+    return static_cast <uint32_t> (block[index]) << 16 | block[index+1];
+}
+
+uint64_t GetUINT64 (const uint16_t* block, const unsigned int index) {
+    return static_cast <uint64_t> (block[index]) << 48
+           | static_cast <uint64_t> (block[index+1]) << 32
+           | static_cast <uint64_t> (block[index+2]) << 16
+           | block[index+3];
+}
+
+void SetUINT32 (uint16_t* block, const unsigned int index,
+                const uint32_t value) {
+    block[index] = static_cast <uint16_t> (value >> 16);
+    block[index+1] = static_cast <uint16_t> (value);
+}
+
+void SetUINT64 (uint16_t* block, const unsigned int index,
+                const uint64_t value) {
+    block[index] = static_cast <uint16_t> (value >> 48);
+    block[index+1] = static_cast <uint16_t> (value >> 32);
+    block[index+2] = static_cast <uint16_t> (value >> 16);
+    block[index+3] = static_cast <uint16_t> (value);
+}
+
+// Get String
+// - two characters per register, stop at the first null character
+void GetString (const uint16_t* block, const unsigned int index,
+                const unsigned int length, std::string* value) {
+    value->clear ();
+    for (unsigned int i = index; i < index + length; i++) {
+        char high = static_cast <char> (block[i] >> 8);
+        char low = static_cast <char> (block[i]);
+        if (high == '\0') {
+            return;
+        }
+        value->push_back (high);
+        if (low == '\0') {
+            return;
+        }
+        value->push_back (low);
+    }
+}
+
+void SetString (uint16_t* block, const unsigned int index,
+                const unsigned int length, const std::string& value) {
+    for (unsigned int i = 0; i < length; i++) {
+        unsigned int c = 2*i;
+        uint16_t high = (c < value.size ()) ? uint8_t(value[c]) : 0;
+        uint16_t low = (c+1 < value.size ()) ? uint8_t(value[c+1]) : 0;
+        block[index+i] = high << 8 | low;
+    }
+}
+
+// Get Hex
+// - eui48 and ipv6 addresses are shown as colon separated hex bytes
+void GetHex (const uint16_t* block, const unsigned int index,
+             const unsigned int length, std::string* value) {
+    static const char kDigits[] = "0123456789ABCDEF";
+    value->clear ();
+    for (unsigned int i = index; i < index + length; i++) {
+        for (int shift = 8; shift >= 0; shift -= 8) {
+            uint8_t byte = block[i] >> shift;
+            if (!value->empty ()) {
+                value->push_back (':');
+            }
+            value->push_back (kDigits[byte >> 4]);
+            value->push_back (kDigits[byte & 0x0F]);
+        }
+    }
+}
+
+// Set Hex
+// - colon separated hex bytes, missing bytes are 0. Returns false and
+// - leaves the block untouched if a byte is not hex or out of range.
+bool SetHex (uint16_t* block, const unsigned int index,
+             const unsigned int length, const std::string& value) {
+    std::vector <unsigned int> bytes (2*length, 0);
+    std::stringstream ss(value);
+    std::string byte;
+    for (unsigned int i = 0; i < bytes.size () && std::getline (ss, byte, ':');
+         i++) {
+        size_t used = 0;
+        try {
+            bytes[i] = std::stoul (byte, &used, 16);
+        } catch (const std::invalid_argument&) {
+            return false;
+        } catch (const std::out_of_range&) {
+            return false;
+        }
+        if (used != byte.size () || bytes[i] > 0xFF) {
+            return false;
+        }
+    }
+    for (unsigned int i = 0; i < length; i++) {
+        block[index + i] = bytes[2*i] << 8 | bytes[2*i + 1];
+    }
+    return true;
+}
+
+// Is Scaled
+// - only numeric points are multiplied by a scale factor
+bool IsScaled (const SunSpecModel::PointType type) {
+    switch (type) {
+        case SunSpecModel::PointType::INT16:
+        case SunSpecModel::PointType::UINT16:
+        case SunSpecModel::PointType::COUNT:
+        case SunSpecModel::PointType::ACC16:
+        case SunSpecModel::PointType::INT32:
+        case SunSpecModel::PointType::UINT32:
+        case SunSpecModel::PointType::ACC32:
+        case SunSpecModel::PointType::FLOAT32:
+        case SunSpecModel::PointType::INT64:
+        case SunSpecModel::PointType::UINT64:
+        case SunSpecModel::PointType::ACC64:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Is Text
+// - points that are decoded to text instead of a number
+bool IsText (const SunSpecModel::PointType type) {
+    return type == SunSpecModel::PointType::STRING
+           || type == SunSpecModel::PointType::IPV6ADDR
+           || type == SunSpecModel::PointType::EUI48;
+}
+
+// To Register
+// - round a scaled value to the nearest integer before it is truncated to
+// - the register width so negative values keep their two's complement form.
+uint64_t ToRegister (const double value) {
+    if (value < 0) {
+        return static_cast <uint64_t> (std::llround (value));
+    }
+    return static_cast <uint64_t> (value + 0.5);
+}
 
-namespace pt = boost::property_tree;
+// In Range
+// - whether the rounded value fits the point type, values outside of it
+// - would wrap when they are truncated to the register width.
+bool InRange (const SunSpecModel::PointType type, const double value) {
+    typedef SunSpecModel::PointType PointType;
+    double rounded = std::round (value);
+    switch (type) {
+        case PointType::INT16:
+        case PointType::SUNSSF:
+            return rounded >= -32768.0 && rounded <= 32767.0;
+        case PointType::UINT16:
+        case PointType::COUNT:
+        case PointType::ACC16:
+        case PointType::ENUM16:
+        case PointType::BITFIELD16:
+            return rounded >= 0 && rounded <= 65535.0;
+        case PointType::INT32:
+            return rounded >= -2147483648.0 && rounded <= 2147483647.0;
+        case PointType::UINT32:
+        case PointType::ACC32:
+        case PointType::ENUM32:
+        case PointType::BITFIELD32:
+        case PointType::IPADDR:
+            return rounded >= 0 && rounded <= 4294967295.0;
+        case PointType::INT64:
+            return rounded >= -9223372036854775808.0
+                   && rounded < 9223372036854775808.0;
+        case PointType::UINT64:
+        case PointType::ACC64:
+            return rounded >= 0 && rounded < 18446744073709551616.0;
+        case PointType::FLOAT32:
+            return std::fabs (value) <= std::numeric_limits<float>::max ();
+        default:
+            return true;
+    }
+}
+
+// Scale
+// - multiplier of a scaled point. Scale factor registers outside of the
+// - block or marked not implemented (0x8000) give NaN.
+double Scale (const SunSpecModel::Point& point,
+              const uint16_t* register_block,
+              const unsigned int length) {
+    if (point.sf_register < 0) {
+        return point.sf_fixed;
+    }
+    if (static_cast <unsigned int> (point.sf_register) >= length
+        || register_block[point.sf_register] == kNotImplemented) {
+        return std::numeric_limits<double>::quiet_NaN ();
+    }
+    return PowerOfTen (static_cast <int16_t> (register_block[point.sf_register]));
+}
+
+}  // namespace
 
 SunSpecModel::SunSpecModel (unsigned int did, unsigned int offset)
     : offset_(offset) {
-    // create filename using a base path, then pad the did number and append
-    // to the base path. The sunspec models are provided as xml so that will be
-    // the file type that is appended ot the end of the filename.
-    std::stringstream ss;
-    ss << "../data/models/smdx/smdx_";
-    ss << std::setfill ('0') << std::setw(5) << did;
-    ss << ".xml";
-    std::string filename = ss.str();
-
-    // Use boosts xml parser to read file and store as member variable.
-    pt::xml_parser::read_xml(filename, smdx_);
-    did_ = smdx_.get <unsigned int> ("sunSpecModels.model.<xmlattr>.id", 0);
-    std::string name;
-    name = smdx_.get <std::string> ("sunSpecModels.model.<xmlattr>.name", "");
-    length_ = smdx_.get <unsigned int> ("sunSpecModels.model.<xmlattr>.len", 0);
+    // the catalog loads each smdx model once and shares it between devices
+    SunSpecCatalog& catalog = SunSpecCatalog::Instance ();
+    std::shared_ptr <const Definition> definition;
+    definition = catalog.GetDefinition (did);
+    did_ = definition->did;
+    length_ = definition->length;
+    table_ = catalog.GetTable (did_, length_);
 
     std::cout << "SunSpec Model Found"
         << "\n\tDID: " << did_
-        << "\n\tName: " << name
+        << "\n\tName: " << definition->name
         << "\n\tLength: " << length_ << std::endl;
-
-    SunSpecModel::GetScalers ();
 }
 
 SunSpecModel::~SunSpecModel() {
 }
 
 
+
+
 // Block To Points
 // - convert raw modbus register block to it's corresponding SunSpec points
 std::map <std::string, std::string> SunSpecModel::BlockToPoints (
     const std::vector <uint16_t>& register_block) {
-    std::map <std::string, std::string> point_map;
-    std::string id, type, scaler;
-    unsigned int offset;
-
-     // Traverse property tree
-    BOOST_FOREACH (pt::ptree::value_type const& node,
-                   smdx_.get_child ("sunSpecModels.model.block")) {
-        pt::ptree subtree = node.second;
-        if( node.first == "point" ) {
-            id = subtree.get <std::string> ("<xmlattr>.id", "");
-            type = subtree.get <std::string> ("<xmlattr>.type", "");
-            scaler = subtree.get <std::string> ("<xmlattr>.sf", "default");
-            offset = subtree.get <unsigned int> ("<xmlattr>.offset", 0);
-
-            // TODO (TS): this should be configured by the smdx file
-            // - the scaled values are a decimal place shift so I use the
-            // - pow() function to raise 10 to the scale value for scaling.
-            if (type == "int16") {
-                float value = register_block[offset];
-                float scale = SunSpecModel::BlockToScaler(register_block,
-                                                          scaler);
-                value = value * scale;
-                point_map[id] = std::to_string(value);
-            } else if (type == "uint16") {
-                float value = register_block[offset];
-                float scale = SunSpecModel::BlockToScaler(register_block,
-                                                          scaler);
-                value = value * scale;
-                point_map[id] = std::to_string(value);
-            } else if (type == "count") {
-                float value = register_block[offset];
-                float scale = SunSpecModel::BlockToScaler(register_block,
-                                                          scaler);
-                value = value * scale;
-                point_map[id] = std::to_string(value);
-            } else if (type == "acc16") {
-                float value = register_block[offset];
-                float scale = SunSpecModel::BlockToScaler(register_block,
-                                                          scaler);
-                value = value * scale;
-                point_map[id] = std::to_string(value);
-            } else if (type == "int32") {
-                float value = SunSpecModel::GetUINT32(register_block,offset);
-                float scale = SunSpecModel::BlockToScaler(register_block,
-                                                          scaler);
-                value = value * scale;
-                point_map[id] = std::to_string(value);
-            } else if (type == "float32") {
-                float value = SunSpecModel::GetUINT32(register_block,offset);
-                float scale = SunSpecModel::BlockToScaler(register_block,
-                                                          scaler);
-                value = value * scale;
-                point_map[id] = std::to_string(value);
-            } else if (type == "acc32") {
-                float value = SunSpecModel::GetUINT32(register_block,offset);
-                float scale = SunSpecModel::BlockToScaler(register_block,
-                                                          scaler);
-                value = value * scale;
-                point_map[id] = std::to_string(value);
-            } else if (type == "enum16") {
-                BOOST_FOREACH (pt::ptree::value_type const& subsubtree,
-                               subtree) {
-                    pt::ptree symbol = subsubtree.second;
-                    std::string reg = std::to_string(register_block[offset]);
-                    if( subsubtree.first == "symbol" && symbol.data() == reg) {
-                        std::string sym;
-                        sym = symbol.get <std::string> ("<xmlattr>.id", "");
-                        point_map[id] = sym;
-                    }
-                }
-            } else if (type == "enum32") {
-                BOOST_FOREACH (pt::ptree::value_type const& subsubtree,
-                               subtree) {
-                    pt::ptree symbol = subsubtree.second;
-                    std::string reg = std::to_string(
-                        SunSpecModel::GetUINT32(register_block,offset)
-                    );
-                    if( subsubtree.first == "symbol" && symbol.data() == reg) {
-                        std::string sym;
-                        sym = symbol.get <std::string> ("<xmlattr>.id", "");
-                        point_map[id] = sym;
-                    }
-                }
-            } else if (type == "bitfield16") {
-                std::vector <std::string> symbols;
-                std::string sym;
+    Values values = SunSpecModel::NewValues ();
+    SunSpecModel::Decode (register_block.data (),
+                          register_block.size (),
+                          &values);
+    return SunSpecModel::ValuesToPoints (values);
+};
 
-                // collect each bits symbol value
-                BOOST_FOREACH (pt::ptree::value_type const& subsubtree,
-                               subtree) {
-                    pt::ptree symbol = subsubtree.second;
-                    if( subsubtree.first == "symbol") {
-                        sym = symbol.get <std::string> ("<xmlattr>.id", "");
-                        symbols.push_back(sym);
-                    }
-                }
 
-                if (!symbols.empty()) {
-                    sym.clear();
+// Points To Block
+// - translated sunspec points into register block for writing to device
+// - points missing from the map are left as zero
+std::vector <uint16_t> SunSpecModel::PointsToBlock (
+    std::map <std::string, std::string>& points) {
+    Values values = SunSpecModel::NewValues ();
+    SunSpecModel::PointsToValues (points, &values);
+    std::vector <uint16_t> register_block (length_, 0);
+    SunSpecModel::Encode (values, &register_block);
+    return register_block;
+};
 
-                    // for each bit add symbol if it is set;
-                    std::bitset<16> bits (register_block[offset]);
-                    for (unsigned int i = 0; i < symbols.size(); i++) {
-                        if (bits[i]) {
-                            sym = sym + symbols[i] + ",";
-                        }
-                    }
-                    sym.pop_back ();  // remove last comma
-                    point_map[id] = sym;
-                }
-            } else if (type == "bitfield32") {
-                std::vector <std::string> symbols;
-                std::string sym;
+// New Values
+// - allocate a value buffer sized for the point table so decoding into it
+// - does not allocate.
+SunSpecModel::Values SunSpecModel::NewValues () const {
+    Values values;
+    values.number.assign (table_->points.size (),
+                          std::numeric_limits<double>::quiet_NaN ());
+    values.symbol.assign (table_->points.size (), -1);
+    values.text.resize (table_->points.size ());
+    return values;
+};
 
-                // collect each bits symbol value
-                BOOST_FOREACH (pt::ptree::value_type const& subsubtree,
-                               subtree) {
-                    pt::ptree symbol = subsubtree.second;
-                    if( subsubtree.first == "symbol") {
-                        sym = symbol.get <std::string> ("<xmlattr>.id", "");
-                        symbols.push_back(sym);
-                    }
-                }
-                if (!symbols.empty()) {
-                    sym.clear();
+// Decode
+// - convert a raw register block into the typed value buffer. Points that
+// - fall outside of the block are marked NaN.
+void SunSpecModel::Decode (const uint16_t* register_block,
+                           const unsigned int length,
+                           Values* values) const {
+    const std::vector <Symbol>& symbols = table_->definition->symbols;
+    const double kNaN = std::numeric_limits<double>::quiet_NaN ();
+    if (values->number.size () != table_->points.size ()) {
+        values->number.resize (table_->points.size ());
+        values->symbol.resize (table_->points.size ());
+        values->text.resize (table_->points.size ());
+    }
 
-                    // for each bit add symbol if it is set;
-                    std::bitset<32> bits (
-                        SunSpecModel::GetUINT32(register_block, offset)
-                    );
+    for (unsigned int i = 0; i < table_->points.size (); i++) {
+        const Point& point = table_->points[i];
+        const unsigned int offset = point.offset;
+        double& value = values->number[i];
+        int32_t& symbol = values->symbol[i];
+        symbol = -1;
 
-                    for (unsigned int i = 0; i < symbols.size(); i++) {
-                        if (bits[i]) {
-                            sym = sym + symbols[i] + ",";
-                        }
-                    }
-                    sym.pop_back ();  // remove last comma
-                    point_map[id] = sym;
+        if (offset + point.length > length) {
+            value = kNaN;
+            continue;
+        }
+
+        switch (point.type) {
+            case PointType::INT16:
+                value = static_cast <int16_t> (register_block[offset]);
+                break;
+            case PointType::SUNSSF:
+                value = static_cast <int16_t> (register_block[offset]);
+                if (register_block[offset] == kNotImplemented) {
+                    value = kNaN;
                 }
-            } else if (type == "sunssf") {
-                int16_t value = register_block[offset];
-                point_map[id] = std::to_string(value);
-            } else if (type == "string") {
-                unsigned int length;
-                length = subtree.get <unsigned int> ("<xmlattr>.len", 0);
-                std::string value = SunSpecModel::GetString(
-                    register_block,offset, length
+                break;
+            case PointType::UINT16:
+            case PointType::COUNT:
+            case PointType::ACC16:
+            case PointType::BITFIELD16:
+                value = register_block[offset];
+                break;
+            case PointType::INT32:
+                value = static_cast <int32_t> (
+                    GetUINT32 (register_block, offset)
                 );
-                point_map[id] = value;
-            } else if (type == "pad") {
-                //TODO (TS): determine how this value is implemented.
-            } else if (type == "ipaddr") {
-                //TODO (TS): determine how this value is implemented.
-            } else if (type == "ipv6addr") {
-                //TODO (TS): determine how this value is implemented.
-            } else if (type == "eui48") {
-                //TODO (TS): determine how this value is implemented.
+                break;
+            case PointType::UINT32:
+            case PointType::ACC32:
+            case PointType::BITFIELD32:
+            case PointType::IPADDR:
+                value = GetUINT32 (register_block, offset);
+                break;
+            case PointType::FLOAT32: {
+                uint32_t bits = GetUINT32 (register_block, offset);
+                float real;
+                std::memcpy (&real, &bits, sizeof(real));
+                value = real;
+                break;
             }
+            case PointType::INT64:
+                value = static_cast <int64_t> (
+                    GetUINT64 (register_block, offset)
+                );
+                break;
+            case PointType::UINT64:
+            case PointType::ACC64:
+                value = GetUINT64 (register_block, offset);
+                break;
+            case PointType::ENUM16:
+            case PointType::ENUM32: {
+                uint32_t raw = (point.type == PointType::ENUM16)
+                    ? register_block[offset]
+                    : GetUINT32 (register_block, offset);
+                value = raw;
+                for (uint32_t s = point.symbol_begin; s < point.symbol_end; s++) {
+                    if (symbols[s].value == raw) {
+                        symbol = symbols[s].id;
+                        break;
+                    }
+                }
+                break;
+            }
+            case PointType::STRING:
+                value = 0;
+                GetString (register_block, offset, point.length,
+                           &values->text[i]);
+                break;
+            case PointType::IPV6ADDR:
+            case PointType::EUI48:
+                value = 0;
+                GetHex (register_block, offset, point.length,
+                        &values->text[i]);
+                break;
+        }
+
+        if (IsScaled (point.type)) {
+            value *= Scale (point, register_block, length);
         }
     }
-    return point_map;
 };
 
-
-// Points To Block
-// - translated sunspec points into register block for writing to device
-std::vector <uint16_t> SunSpecModel::PointsToBlock (
-    std::map <std::string, std::string>& points) {
-    std::vector <uint16_t> register_block (length_, 0);  // initialize block
-    std::string id, type, scaler;
-    unsigned int offset;
-
-    // Traverse property tree
-    // for each child object create a node object
-    BOOST_FOREACH (pt::ptree::value_type const& node,
-                   smdx_.get_child ("sunSpecModels.model.block")) {
-        pt::ptree subtree = node.second;
-        if( node.first == "point" ) {
-            id = subtree.get <std::string> ("<xmlattr>.id", "");
-            type = subtree.get <std::string> ("<xmlattr>.type", "");
-            scaler = subtree.get <std::string> ("<xmlattr>.sf", "default");
-            offset = subtree.get <unsigned int> ("<xmlattr>.offset", 0);
-
-            // TODO (TS): this should be configured by the smdx file
-            if (type == "int16") {
-                float value = std::stof(points[id]);
-                float scale = SunSpecModel::PointsToScaler(points,
-                                                          scaler);
-                register_block[offset] = value / scale;
-            } else if (type == "uint16") {
-                float value = std::stof(points[id]);
-                float scale = SunSpecModel::PointsToScaler(points,
-                                                          scaler);
-                register_block[offset] = value / scale;
-            } else if (type == "count") {
-                float value = std::stof(points[id]);
-                float scale = SunSpecModel::PointsToScaler(points,
-                                                          scaler);
-                register_block[offset] = value / scale;
-            } else if (type == "acc16") {
-                float value = std::stof(points[id]);
-                float scale = SunSpecModel::PointsToScaler(points,
-                                                          scaler);
-                register_block[offset] = value / scale;
-            } else if (type == "int32") {
-                float value = std::stof(points[id]);
-                float scale = SunSpecModel::PointsToScaler(points,
-                                                          scaler);
-                value = value / scale;
-                SunSpecModel::SetUINT32(&register_block,offset, value);
-            } else if (type == "float32") {
-                float value = std::stof(points[id]);
-                float scale = SunSpecModel::PointsToScaler(points,
-                                                          scaler);
-                value = value / scale;
-                SunSpecModel::SetUINT32(&register_block,offset, value);
-            } else if (type == "acc32") {
-                float value = std::stof(points[id]);
-                float scale = SunSpecModel::PointsToScaler(points,
-                                                          scaler);
-                value = value / scale;
-                SunSpecModel::SetUINT32(&register_block,offset, value);
-            } else if (type == "enum16") {
-                //TODO (TS): I don't believe these values can be written to
-            } else if (type == "enum32") {
-                //TODO (TS): I don't believe these values can be written to
-            } else if (type == "bitfield16") {
-                //TODO (TS): I don't believe these values can be written to
-            } else if (type == "bitfield32") {
-                //TODO (TS): I don't believe these values can be written to
-            } else if (type == "string") {
-                //TODO (TS): I don't believe these values can be written to
-            } else if (type == "pad") {
-                //TODO (TS): I don't believe these values can be written to
-            } else if (type == "ipaddr") {
-                //TODO (TS): determine how this value is implemented.
-            } else if (type == "ipv6addr") {
-                //TODO (TS): determine how this value is implemented.
-            } else if (type == "eui48") {
-                //TODO (TS): determine how this value is implemented.
+// Encode
+// - convert the typed value buffer into registers. The scale factors are
+// - written first so scaled points can be divided by the value being sent.
+void SunSpecModel::Encode (const Values& values,
+                           std::vector <uint16_t>* register_block) const {
+    std::vector <uint16_t>& block = *register_block;
+
+    for (unsigned int pass = 0; pass < 2; pass++) {
+        for (unsigned int i = 0; i < table_->points.size (); i++) {
+            const Point& point = table_->points[i];
+            bool scaler = point.type == PointType::SUNSSF;
+
+            if ((pass == 0) != scaler
+                || point.offset + point.length > block.size ()) {
+                continue;
             }
+            SunSpecModel::EncodePoint (i, values.number[i], values.text[i],
+                                       block.data (), block.size (),
+                                       block.data () + point.offset);
         }
     }
-
-    return register_block;
 };
 
-// Accessor Methods
+// Encode Point
+// - encode one point into the registers it occupies. Scale factors are read
+// - from the model block given by scalers, of scalers_length registers.
+// - Returns false when there is no value to encode, its scale factor is
+// - missing or the scaled value does not fit the point type.
+bool SunSpecModel::EncodePoint (const unsigned int index,
+                                double value,
+                                const std::string& text,
+                                const uint16_t* scalers,
+                                const unsigned int scalers_length,
+                                uint16_t* registers) const {
+    const Point& point = table_->points[index];
+
+    if (IsText (point.type)) {
+        if (text.empty ()) {
+            return false;
+        }
+    } else if (std::isnan (value)) {
+        return false;
+    }
 
-unsigned int SunSpecModel::GetLength () {
-    return length_;
-};
+    if (IsScaled (point.type)) {
+        value /= Scale (point, scalers, scalers_length);
+        if (std::isnan (value)) {
+            return false;
+        }
+    }
+    if (!IsText (point.type) && !InRange (point.type, value)) {
+        return false;
+    }
 
-unsigned int SunSpecModel::GetOffset () {
-    return offset_;
+    switch (point.type) {
+        case PointType::INT16:
+        case PointType::UINT16:
+        case PointType::COUNT:
+        case PointType::ACC16:
+        case PointType::ENUM16:
+        case PointType::BITFIELD16:
+        case PointType::SUNSSF:
+            registers[0] = static_cast <uint16_t> (ToRegister (value));
+            break;
+        case PointType::INT32:
+        case PointType::UINT32:
+        case PointType::ACC32:
+        case PointType::ENUM32:
+        case PointType::BITFIELD32:
+        case PointType::IPADDR:
+            SetUINT32 (registers, 0,
+                       static_cast <uint32_t> (ToRegister (value)));
+            break;
+        case PointType::FLOAT32: {
+            float real = value;
+            uint32_t bits;
+            std::memcpy (&bits, &real, sizeof(bits));
+            SetUINT32 (registers, 0, bits);
+            break;
+        }
+        case PointType::INT64:
+        case PointType::UINT64:
+        case PointType::ACC64:
+            SetUINT64 (registers, 0, ToRegister (value));
+            break;
+        case PointType::STRING:
+            SetString (registers, 0, point.length, text);
+            break;
+        case PointType::IPV6ADDR:
+        case PointType::EUI48:
+            return SetHex (registers, 0, point.length, text);
+    }
+    return true;
 };
 
+// Values To Points
+// - string view of the value buffer, points without a value are omitted
+std::map <std::string, std::string> SunSpecModel::ValuesToPoints (
+    const Values& values) const {
+    const std::vector <Symbol>& symbols = table_->definition->symbols;
+    const std::vector <std::string>& symbol_names =
+        table_->definition->symbol_names;
+    std::map <std::string, std::string> point_map;
 
-void SunSpecModel::GetScalers() {
-    // if there is no specified scaler then set the scaler to 0 to no change 
-    // the magnitude
-    scalers_["default"] = 0;
+    for (unsigned int i = 0; i < table_->points.size (); i++) {
+        const Point& point = table_->points[i];
+        const double value = values.number[i];
+        const std::string& id = table_->names[i];
 
-     // Traverse property tree
-    BOOST_FOREACH (pt::ptree::value_type const& node,
-                   smdx_.get_child ("sunSpecModels.model.block")) {
-        pt::ptree subtree = node.second;
-        std::string id;
-        unsigned int offset;
-        if( node.first == "point" ) {
+        if (IsText (point.type)) {
+            point_map[id] = values.text[i];
+            continue;
+        } else if (std::isnan (value)) {
+            continue;
+        }
 
-            if (subtree.get <std::string> ("<xmlattr>.type") == "sunssf") {
-                id = subtree.get <std::string> ("<xmlattr>.id");
-                offset = subtree.get <int> ("<xmlattr>.offset");
-                scalers_[id] = offset;
+        switch (point.type) {
+            case PointType::SUNSSF:
+                point_map[id] = std::to_string (static_cast <int> (value));
+                break;
+            case PointType::ENUM16:
+            case PointType::ENUM32:
+                if (values.symbol[i] >= 0) {
+                    point_map[id] = symbol_names[values.symbol[i]];
+                } else {
+                    point_map[id] = std::to_string (
+                        static_cast <uint32_t> (value)
+                    );
+                }
+                break;
+            case PointType::BITFIELD16:
+            case PointType::BITFIELD32: {
+                // for each bit add symbol if it is set;
+                uint32_t bits = static_cast <uint32_t> (value);
+                std::string sym;
+                for (uint32_t s = point.symbol_begin; s < point.symbol_end; s++) {
+                    if (symbols[s].value < 32 && (bits >> symbols[s].value) & 1) {
+                        if (!sym.empty ()) {
+                            sym += ",";
+                        }
+                        sym += symbol_names[symbols[s].id];
+                    }
+                }
+                point_map[id] = sym;
+                break;
+            }
+            case PointType::IPADDR: {
+                uint32_t address = static_cast <uint32_t> (value);
+                point_map[id] = std::to_string (address >> 24) + "."
+                    + std::to_string ((address >> 16) & 0xFF) + "."
+                    + std::to_string ((address >> 8) & 0xFF) + "."
+                    + std::to_string (address & 0xFF);
+                break;
             }
+            default:
+                point_map[id] = std::to_string (value);
+                break;
         }
     }
+    return point_map;
 };
 
-// Block To Scaler
-// - this function is just a hack to get non-sunspec complient devices to be
-// - interpreted.
-float SunSpecModel::BlockToScaler (const std::vector <uint16_t>& register_block,
-                                   std::string scaler) {
-    if (std::isdigit (*scaler.c_str())) {
-        return std::stof(scaler);
-    } else {
-        return std::pow(10, register_block[scalers_[scaler]]);
+// Points To Values
+// - parse a string view back into the value buffer. Enums and bitfields
+// - accept their symbol names, points missing from the map are set to NaN.
+void SunSpecModel::PointsToValues (
+    const std::map <std::string, std::string>& points,
+    Values* values) const {
+    *values = SunSpecModel::NewValues ();
+
+    for (unsigned int i = 0; i < table_->points.size (); i++) {
+        auto it = points.find (table_->names[i]);
+        if (it != points.end ()) {
+            SunSpecModel::ParsePoint (i, it->second, &values->number[i],
+                                      &values->symbol[i], &values->text[i]);
+        }
     }
 };
 
-// Point To Scaler
-// - this function is just a hack to get non-sunspec complient devices to be
-// - interpreted.
-float SunSpecModel::PointsToScaler (std::map <std::string, std::string>& points,
-                                    std::string scaler) {
-    if (std::isdigit (*scaler.c_str())) {
-        return std::stof(scaler);
-    } else if (scaler == "default") {
-        return std::pow(10, scalers_[scaler]);
-    } else {
-        return std::stof(points[scaler]);
+// Parse Point
+// - convert the string form of one point to its typed value
+bool SunSpecModel::ParsePoint (const unsigned int index,
+                               const std::string& data,
+                               double* number,
+                               int32_t* symbol,
+                               std::string* text) const {
+    const double kNaN = std::numeric_limits<double>::quiet_NaN ();
+    const std::vector <Symbol>& symbols = table_->definition->symbols;
+    const std::vector <std::string>& symbol_names =
+        table_->definition->symbol_names;
+    const Point& point = table_->points[index];
+    *number = kNaN;
+    *symbol = -1;
+
+    try {
+        switch (point.type) {
+            case PointType::STRING:
+            case PointType::IPV6ADDR:
+            case PointType::EUI48:
+                *text = data;
+                break;
+            case PointType::ENUM16:
+            case PointType::ENUM32: {
+                for (uint32_t s = point.symbol_begin; s < point.symbol_end; s++) {
+                    if (symbol_names[symbols[s].id] == data) {
+                        *number = symbols[s].value;
+                        *symbol = symbols[s].id;
+                        break;
+                    }
+                }
+                if (std::isnan (*number)) {
+                    *number = std::stod (data);
+                }
+                break;
+            }
+            case PointType::BITFIELD16:
+            case PointType::BITFIELD32: {
+                uint32_t bits = 0;
+                std::stringstream ss(data);
+                std::string name;
+                while (std::getline (ss, name, ',')) {
+                    bool found = false;
+                    for (uint32_t s = point.symbol_begin; s < point.symbol_end; s++) {
+                        if (symbol_names[symbols[s].id] == name
+                            && symbols[s].value < 32) {
+                            bits |= uint32_t(1) << symbols[s].value;
+                            found = true;
+                        }
+                    }
+                    if (!found) {
+                        *number = kNaN;
+                        return false;
+                    }
+                }
+                *number = bits;
+                break;
+            }
+            case PointType::IPADDR: {
+                uint32_t address = 0;
+                unsigned int octets = 0;
+                std::stringstream ss(data);
+                std::string octet;
+                while (std::getline (ss, octet, '.')) {
+                    size_t used = 0;
+                    unsigned long value = std::stoul (octet, &used);
+                    if (used != octet.size () || value > 0xFF || ++octets > 4) {
+                        return false;
+                    }
+                    address = address << 8 | value;
+                }
+                if (octets != 4) {
+                    return false;
+                }
+                *number = address;
+                break;
+            }
+            default:
+                *number = std::stod (data);
+                break;
+        }
+    } catch (...) {
+        *number = kNaN;
+        return false;
     }
+    return true;
 };
 
-uint32_t SunSpecModel::GetUINT32 (const std::vector <uint16_t>& block,
-                                  const unsigned int index) {
-    // bitshift the first register 16 bits and then append second register
-    // this process is dependant on modbus
-    return (block[index] << 16) | block[index];
+// Accessor Methods
+
+int SunSpecModel::FindPoint (const std::string& id) const {
+    auto it = table_->index.find (id);
+    return (it != table_->index.end ()) ? static_cast <int> (it->second) : -1;
 };
 
+const std::vector <SunSpecModel::Point>& SunSpecModel::GetPoints () const {
+    return table_->points;
+};
 
-uint64_t SunSpecModel::GetUINT64 (const std::vector <uint16_t>& block,
-                                  const unsigned int index) {
-    uint64_t value = static_cast<uint64_t>(block[index]) << 48
-                     | static_cast<uint64_t>(block[index+1]) << 32
-                     | static_cast<uint64_t>(block[index+2]) << 16
-                     | block[index+3];
-    return value;
+const std::string& SunSpecModel::GetPointName (const unsigned int index) const {
+    return table_->names.at (index);
 };
 
+const std::string& SunSpecModel::GetSymbolName (const int32_t id) const {
+    return table_->definition->symbol_names.at (id);
+};
 
-std::string SunSpecModel::GetString (const std::vector <uint16_t>& block,
-                                     const unsigned int index,
-                                     const unsigned int length) {
-    std::stringstream ss;
-    for (unsigned int i = index; i < length; i++) {
-        ss << static_cast <char> (block[i] >> 8);
-        ss << static_cast <char> (block[i]);
-    }
-    return ss.str();
+// Set Length
+// - the device reports the true model length, which decides how many
+// - repeating blocks exist, so switch to the table expanded for it.
+void SunSpecModel::SetLength (const unsigned int length) {
+    length_ = length;
+    table_ = SunSpecCatalog::Instance ().GetTable (did_, length_);
 };
 
+unsigned int SunSpecModel::GetLength () {
+    return length_;
+};
 
-void SunSpecModel::SetUINT32 (std::vector <uint16_t>* block,
-                              const unsigned int index,
-                              const uint32_t value) {
-    std::vector <uint16_t>& deref_block = *block;
-    deref_block[index] = static_cast <uint16_t> (value >> 16);
-    deref_block[index+1] = static_cast <uint16_t> (value);
+unsigned int SunSpecModel::GetOffset () {
+    return offset_;
 };
 
+// Add Point
+// - resolve the scale factor of a definition and append it to the table.
+// - A numeric sf is an exponent unless it has a decimal point, in which
+// - case it is a multiplier used by the non-sunspec device models.
+static void AddPoint (const SunSpecModel::PointDefinition& definition,
+                      const unsigned int base,
+                      const std::map <std::string, uint16_t>& local_scalers,
+                      const std::map <std::string, uint16_t>& fixed_scalers,
+                      const std::string& prefix,
+                      SunSpecModel::Table* table) {
+    SunSpecModel::Point point;
+    point.offset = base + definition.offset;
+    point.length = definition.length;
+    point.type = definition.type;
+    point.writable = definition.writable;
+    point.sf_register = -1;
+    point.sf_fixed = 1;
+    point.symbol_begin = definition.symbol_begin;
+    point.symbol_end = definition.symbol_end;
+
+    const std::string& sf = definition.sf;
+    if (sf.find_first_not_of (' ') != std::string::npos) {
+        auto local = local_scalers.find (sf);
+        auto fixed = fixed_scalers.find (sf);
+        if (local != local_scalers.end ()) {
+            point.sf_register = local->second;
+        } else if (fixed != fixed_scalers.end ()) {
+            point.sf_register = fixed->second;
+        } else {
+            try {
+                if (sf.find ('.') != std::string::npos) {
+                    point.sf_fixed = std::stod (sf);
+                } else {
+                    point.sf_fixed = PowerOfTen (std::stoi (sf));
+                }
+            } catch (...) {
+                std::cout << "[ERROR] : unresolved scale factor "
+                    << sf << " for " << definition.id << std::endl;
+            }
+        }
+    }
 
-void SunSpecModel::SetUINT64 (std::vector <uint16_t>* block,
-                              const unsigned int index,
-                              const uint64_t value) {
-    std::vector <uint16_t>& deref_block = *block;
-    deref_block[index] = static_cast <uint16_t> (value >> 48);
-    deref_block[index+1] = static_cast <uint16_t> (value >> 32);
-    deref_block[index+2] = static_cast <uint16_t> (value >> 16);
-    deref_block[index+3] = static_cast <uint16_t> (value);
-};
+    table->index[prefix + definition.id] = table->points.size ();
+    table->points.push_back (point);
+    table->names.push_back (prefix + definition.id);
+}
+
+// Expand
+// - flatten the fixed block followed by each repeating block into a point
+// - table. Repeated points are named <block>.<n>.<point> starting at 1.
+std::shared_ptr <const SunSpecModel::Table> SunSpecModel::Expand (
+    const std::shared_ptr <const Definition>& definition,
+    const unsigned int length) {
+    std::shared_ptr <Table> table (new Table);
+    table->definition = definition;
+    table->length = length;
+
+    unsigned int repeats = 0;
+    if (definition->repeating_length > 0
+        && length > definition->fixed_length) {
+        repeats = (length - definition->fixed_length)
+            / definition->repeating_length;
+    }
 
+    std::map <std::string, uint16_t> fixed_scalers, repeating_scalers;
+    for (const PointDefinition& point : definition->fixed) {
+        if (point.type == PointType::SUNSSF) {
+            fixed_scalers[point.id] = point.offset;
+        }
+    }
+    for (const PointDefinition& point : definition->repeating) {
+        if (point.type == PointType::SUNSSF) {
+            repeating_scalers[point.id] = point.offset;
+        }
+    }
+
+    for (const PointDefinition& point : definition->fixed) {
+        AddPoint (point, 0, fixed_scalers, fixed_scalers, "", table.get ());
+    }
+
+    for (unsigned int n = 0; n < repeats; n++) {
+        unsigned int base = definition->fixed_length
+            + n*definition->repeating_length;
+        std::string prefix = definition->repeating_name + "."
+            + std::to_string (n + 1) + ".";
+        std::map <std::string, uint16_t> local;
+        for (auto& scaler : repeating_scalers) {
+            local[scaler.first] = base + scaler.second;
+        }
+        for (const PointDefinition& point : definition->repeating) {
+            AddPoint (point, base, local, fixed_scalers, prefix, table.get ());
+        }
+    }
+    return table;
+};
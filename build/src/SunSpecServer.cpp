@@ -0,0 +1,643 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "include/SunSpecServer.h"
+#include "include/Logger.h"
+
+namespace {
+
+// SunSpec register map constants
+// - "SunS" marker at the base address, then the model headers (id, length)
+// - and blocks, closed by the end model.
+const uint16_t kSunSpecMarker[] = {0x5375, 0x6e53};
+const unsigned int kHeaderLength = 2;
+const uint16_t kEndModel = 0xFFFF;
+
+// Modbus TCP constants
+const unsigned int kMbapLength = 7;     // transaction, protocol, length, unit
+const unsigned int kMaxLength = 254;    // unit id and the largest pdu
+const unsigned int kMaxReadRegisters = 125;
+const unsigned int kMaxWriteRegisters = 123;
+const uint8_t kReadHoldingRegisters = 0x03;
+const uint8_t kWriteSingleRegister = 0x06;
+const uint8_t kWriteMultipleRegisters = 0x10;
+const uint8_t kIllegalFunction = 0x01;
+const uint8_t kIllegalDataAddress = 0x02;
+const uint8_t kIllegalDataValue = 0x03;
+const uint8_t kServerDeviceBusy = 0x06;
+
+// storage control modes (124 StorCtl_Mod) and charge status symbols
+const unsigned int kCharge = 1 << 0;
+const unsigned int kDischarge = 1 << 1;
+const double kDischarging = 3;
+const double kCharging = 4;
+const double kHolding = 6;
+
+const unsigned int kEvents = 64;
+const int kWaitMs = 100;    // how often the server thread checks for Stop
+
+// Get Unsigned
+// - optional unsigned configuration value
+unsigned int GetUnsigned (tsu::string_map& init,
+                          const std::string& key,
+                          const unsigned int fallback) {
+    if (init[key].empty ()) {
+        return fallback;
+    }
+    return stoul (init[key]);
+}
+
+unsigned int GetUINT16 (const uint8_t* data) {
+    return (data[0] << 8) | data[1];
+}
+
+void PutUINT16 (const unsigned int value, std::string* data) {
+    data->push_back (static_cast <char> (value >> 8));
+    data->push_back (static_cast <char> (value & 0xFF));
+}
+
+}  // namespace
+
+SunSpecServer::SunSpecServer (tsu::string_map& init)
+    : port_(GetUnsigned (init, "port", 5020)),
+      base_(GetUnsigned (init, "base", 40000)),
+      max_clients_(GetUnsigned (init, "clients", 64)),
+      max_writes_(GetUnsigned (init, "writes", 1024)),
+      import_limit_(-1),
+      sequence_(0),
+      listener_(-1),
+      epoll_(-1),
+      running_(false),
+      requests_(0) {
+    MappedPoint none = {-1, -1};
+    rated_energy_ = rated_import_ = rated_export_ = none;
+    state_of_charge_ = charge_status_ = watts_ = none;
+    max_charge_ = control_mode_ = charge_rate_ = discharge_rate_ = none;
+    charge_state_ = storage_status_ = none;
+}
+
+SunSpecServer::~SunSpecServer () {
+    SunSpecServer::Stop ();
+}
+
+// Add Model
+// - models are laid out in the order they are added, models without an smdx
+// - file or with an id that does not fit the header register are skipped
+void SunSpecServer::AddModel (const unsigned int did,
+                              tsu::string_map& points) {
+    if (did >= kEndModel) {
+        std::cout << "[ERROR] : model " << did << " id out of range\n";
+        Logger("ERROR") << "Server\tmodel " << did << " id out of range";
+        return;
+    }
+
+    unsigned int offset = base_ + 2 + kHeaderLength;
+    if (!models_.empty ()) {
+        offset = models_.back ().offset_ + models_.back ().length_
+                 + kHeaderLength;
+    }
+
+    try {
+        SunSpecModel model (did, offset);
+        SunSpecModel::Values values;
+        model.PointsToValues (points, &values);
+        models_.push_back (model);
+        values_.push_back (values);
+    } catch (const std::exception& error) {
+        std::cout << "[ERROR] : model " << did << " " << error.what () << '\n';
+        Logger("ERROR") << "Server\tmodel " << did << " unsupported";
+    }
+}  // end Add Model
+
+// Start
+// - build the register image and the writable registers and start serving
+bool SunSpecServer::Start () {
+    image_.assign (2, 0);
+    image_[0] = kSunSpecMarker[0];
+    image_[1] = kSunSpecMarker[1];
+    for (unsigned int i = 0; i < models_.size (); i++) {
+        std::vector <uint16_t> block (models_[i].length_, 0);
+        models_[i].Encode (values_[i], &block);
+        image_.push_back (models_[i].did_);
+        image_.push_back (models_[i].length_);
+        image_.insert (image_.end (), block.begin (), block.end ());
+    }
+    image_.push_back (kEndModel);
+    image_.push_back (0);
+
+    writable_.assign (image_.size (), false);
+    for (auto& model : models_) {
+        for (auto& point : model.GetPoints ()) {
+            unsigned int begin = model.offset_ - base_ + point.offset;
+            for (unsigned int i = 0; point.writable && i < point.length; i++) {
+                writable_[begin + i] = true;
+            }
+        }
+    }
+
+    std::vector <std::atomic <uint16_t>> snapshot (image_.size ());
+    snapshot_.swap (snapshot);
+    SunSpecServer::Store ();
+
+    // resource points, 802 battery and 124 storage
+    rated_energy_ = SunSpecServer::Map (802, "WHRtg");
+    rated_import_ = SunSpecServer::Map (802, "WChaRteMax");
+    rated_export_ = SunSpecServer::Map (802, "WDisChaRteMax");
+    state_of_charge_ = SunSpecServer::Map (802, "SoC");
+    charge_status_ = SunSpecServer::Map (802, "ChaSt");
+    watts_ = SunSpecServer::Map (802, "W");
+    max_charge_ = SunSpecServer::Map (124, "WChaMax");
+    control_mode_ = SunSpecServer::Map (124, "StorCtl_Mod");
+    charge_rate_ = SunSpecServer::Map (124, "InWRte");
+    discharge_rate_ = SunSpecServer::Map (124, "OutWRte");
+    charge_state_ = SunSpecServer::Map (124, "ChaState");
+    storage_status_ = SunSpecServer::Map (124, "ChaSt");
+
+    listener_ = socket (AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    int reuse = 1;
+    sockaddr_in address;
+    std::memset (&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons (port_);
+    address.sin_addr.s_addr = htonl (INADDR_ANY);
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = listener_;
+    if (listener_ < 0
+        || setsockopt (listener_, SOL_SOCKET, SO_REUSEADDR,
+                       &reuse, sizeof(reuse)) < 0
+        || bind (listener_, reinterpret_cast <sockaddr*> (&address),
+                 sizeof(address)) < 0
+        || listen (listener_, SOMAXCONN) < 0
+        || (epoll_ = epoll_create1 (0)) < 0
+        || epoll_ctl (epoll_, EPOLL_CTL_ADD, listener_, &event) < 0) {
+        std::cout << "[ERROR] : server port " << port_ << " "
+            << std::strerror (errno) << '\n';
+        Logger("ERROR") << "Server\tport " << port_ << "\t"
+            << std::strerror (errno);
+        SunSpecServer::Stop ();
+        return false;
+    }
+
+    running_ = true;
+    thread_ = std::thread (&SunSpecServer::Serve, this);
+    return true;
+}  // end Start
+
+// Stop
+// - the server thread notices within kWaitMs
+void SunSpecServer::Stop () {
+    running_ = false;
+    if (thread_.joinable ()) {
+        thread_.join ();
+    }
+    for (auto& client : clients_) {
+        close (client.first);
+    }
+    clients_.clear ();
+    if (epoll_ >= 0) {
+        close (epoll_);
+        epoll_ = -1;
+    }
+    if (listener_ >= 0) {
+        close (listener_);
+        listener_ = -1;
+    }
+}  // end Stop
+
+// Publish
+// - apply the queued writes, copy the resource state into the models and
+// - store the new image. Called from the resource task, a write queue that
+// - is in use is left for the next call.
+void SunSpecServer::Publish (DistributedEnergyResource* der) {
+    std::unique_lock <std::mutex> lock (writes_mutex_, std::try_to_lock);
+    if (lock.owns_lock ()) {
+        applying_.swap (writes_);
+        lock.unlock ();
+    }
+
+    if (import_limit_ < 0) {
+        import_limit_ = der->GetRatedImportPower ();
+    }
+
+    bool control = false;
+    for (auto& write : applying_) {
+        std::copy (write.registers.begin (), write.registers.end (),
+                   image_.begin () + (write.address - base_));
+        control = control
+                  || SunSpecServer::Touches (write, control_mode_)
+                  || SunSpecServer::Touches (write, charge_rate_)
+                  || SunSpecServer::Touches (write, discharge_rate_);
+        if (SunSpecServer::Touches (write, max_charge_)) {
+            double watts = SunSpecServer::GetValue (max_charge_);
+            if (watts >= 0) {
+                der->SetRatedImportPower (std::min (watts, import_limit_));
+            }
+        }
+    }
+    applying_.clear ();
+    if (control) {
+        SunSpecServer::Control (der);
+    }
+
+    double import_power = der->GetImportPower ();
+    double export_power = der->GetExportPower ();
+    double state_of_charge = 0;
+    if (der->GetRatedExportEnergy () > 0) {
+        state_of_charge = 100.0 * der->GetExportEnergy ()
+                          / der->GetRatedExportEnergy ();
+    }
+    double status = kHolding;
+    if (import_power > 0) {
+        status = kCharging;
+    } else if (export_power > 0) {
+        status = kDischarging;
+    }
+
+    SunSpecServer::SetValue (rated_energy_, der->GetRatedExportEnergy ());
+    SunSpecServer::SetValue (rated_import_, der->GetRatedImportPower ());
+    SunSpecServer::SetValue (rated_export_, der->GetRatedExportPower ());
+    SunSpecServer::SetValue (state_of_charge_, state_of_charge);
+    SunSpecServer::SetValue (charge_status_, status);
+    SunSpecServer::SetValue (watts_, export_power - import_power);
+    SunSpecServer::SetValue (max_charge_, der->GetRatedImportPower ());
+    SunSpecServer::SetValue (charge_state_, state_of_charge);
+    SunSpecServer::SetValue (storage_status_, status);
+    SunSpecServer::Store ();
+}  // end Publish
+
+// Read Registers
+// - copy registers from the last published image, retrying if Publish
+// - stored a new image during the copy
+bool SunSpecServer::ReadRegisters (const unsigned int address,
+                                   const unsigned int length,
+                                   uint16_t* registers) {
+    if (address < base_ || address - base_ + length > snapshot_.size ()) {
+        return false;
+    }
+
+    unsigned int begin = address - base_;
+    while (true) {
+        unsigned int sequence = sequence_.load (std::memory_order_acquire);
+        if (sequence & 1) {
+            std::this_thread::yield ();
+            continue;
+        }
+        for (unsigned int i = 0; i < length; i++) {
+            registers[i] = snapshot_[begin + i].load (std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence (std::memory_order_acquire);
+        if (sequence_.load (std::memory_order_relaxed) == sequence) {
+            return true;
+        }
+    }
+}  // end Read Registers
+
+unsigned long SunSpecServer::GetRequests () {
+    return requests_;
+}
+
+// Serve
+// - server thread, every socket is non blocking and handled as it is ready
+void SunSpecServer::Serve () {
+    epoll_event events[kEvents];
+    while (running_) {
+        int count = epoll_wait (epoll_, events, kEvents, kWaitMs);
+        for (int i = 0; i < count; i++) {
+            int socket = events[i].data.fd;
+            if (socket == listener_) {
+                SunSpecServer::Accept ();
+                continue;
+            }
+
+            auto client = clients_.find (socket);
+            if (client == clients_.end ()) {
+                continue;
+            }
+            bool open = !(events[i].events & (EPOLLERR | EPOLLHUP));
+            if (open && (events[i].events & EPOLLIN)) {
+                open = SunSpecServer::Receive (&client->second);
+            }
+            if (open && (events[i].events & EPOLLOUT)) {
+                open = SunSpecServer::Send (&client->second);
+            }
+            if (!open) {
+                epoll_ctl (epoll_, EPOLL_CTL_DEL, socket, NULL);
+                close (socket);
+                clients_.erase (socket);
+            }
+        }
+    }
+}  // end Serve
+
+// Accept
+// - clients over the limit are closed straight away
+void SunSpecServer::Accept () {
+    while (true) {
+        int socket = accept4 (listener_, NULL, NULL, SOCK_NONBLOCK);
+        if (socket < 0) {
+            return;
+        }
+        if (clients_.size () >= max_clients_) {
+            Logger("ERROR") << "Server\tclient limit " << max_clients_;
+            close (socket);
+            continue;
+        }
+
+        int delay = 1;
+        setsockopt (socket, IPPROTO_TCP, TCP_NODELAY, &delay, sizeof(delay));
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = socket;
+        if (epoll_ctl (epoll_, EPOLL_CTL_ADD, socket, &event) < 0) {
+            close (socket);
+            continue;
+        }
+        Client& client = clients_[socket];
+        client.socket = socket;
+        client.blocked = false;
+    }
+}  // end Accept
+
+// Receive
+// - answer every complete request, clients may pipeline requests
+bool SunSpecServer::Receive (Client* client) {
+    char buffer[4096];
+    while (true) {
+        ssize_t received = recv (client->socket, buffer, sizeof(buffer), 0);
+        if (received > 0) {
+            client->input.append (buffer, received);
+        } else if (received == 0) {
+            return false;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else {
+            return false;
+        }
+    }
+
+    size_t used = 0;
+    while (client->input.size () - used >= kMbapLength) {
+        const uint8_t* header =
+            reinterpret_cast <const uint8_t*> (client->input.data ()) + used;
+        unsigned int length = GetUINT16 (header + 4);
+        if (length < 2 || length > kMaxLength) {
+            return false;
+        }
+        if (client->input.size () - used < 6 + length) {
+            break;
+        }
+        SunSpecServer::Respond (client->input.substr (used, 6 + length),
+                                &client->output);
+        used += 6 + length;
+    }
+    client->input.erase (0, used);
+
+    if (!client->blocked) {
+        return SunSpecServer::Send (client);
+    }
+    return true;
+}  // end Receive
+
+// Send
+// - write what the socket takes and wait for EPOLLOUT for the rest
+bool SunSpecServer::Send (Client* client) {
+    size_t sent = 0;
+    while (sent < client->output.size ()) {
+        ssize_t count = send (client->socket,
+                              client->output.data () + sent,
+                              client->output.size () - sent,
+                              MSG_NOSIGNAL);
+        if (count > 0) {
+            sent += count;
+        } else if (count < 0 && errno == EINTR) {
+            continue;
+        } else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            return false;
+        }
+    }
+    client->output.erase (0, sent);
+
+    bool blocked = !client->output.empty ();
+    if (blocked != client->blocked) {
+        epoll_event event;
+        event.events = blocked ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        event.data.fd = client->socket;
+        epoll_ctl (epoll_, EPOLL_CTL_MOD, client->socket, &event);
+        client->blocked = blocked;
+    }
+    return true;
+}  // end Send
+
+// Respond
+// - append the response to one MBAP framed request
+void SunSpecServer::Respond (const std::string& request,
+                             std::string* response) {
+    const uint8_t* frame = reinterpret_cast <const uint8_t*> (request.data ());
+    uint8_t function = frame[kMbapLength];
+    const uint8_t* data = frame + kMbapLength + 1;
+    unsigned int length = request.size () - kMbapLength - 1;
+    requests_++;
+
+    std::string pdu (1, static_cast <char> (function));
+    uint8_t exception = 0;
+    switch (function) {
+        case kReadHoldingRegisters:
+            exception = SunSpecServer::ReadHoldingRegisters (data, length,
+                                                              &pdu);
+            break;
+        case kWriteSingleRegister:
+            if (length != 4) {
+                exception = kIllegalDataValue;
+                break;
+            }
+            exception = SunSpecServer::WriteRegisters (GetUINT16 (data),
+                                                       data + 2, 1);
+            pdu.append (reinterpret_cast <const char*> (data), 4);
+            break;
+        case kWriteMultipleRegisters: {
+            unsigned int count = length < 5 ? 0 : GetUINT16 (data + 2);
+            if (count == 0 || count > kMaxWriteRegisters
+                || data[4] != 2*count || length != 5 + 2*count) {
+                exception = kIllegalDataValue;
+                break;
+            }
+            exception = SunSpecServer::WriteRegisters (GetUINT16 (data),
+                                                       data + 5, count);
+            pdu.append (reinterpret_cast <const char*> (data), 4);
+            break;
+        }
+        default:
+            exception = kIllegalFunction;
+            break;
+    }
+    if (exception) {
+        pdu.assign (1, static_cast <char> (function | 0x80));
+        pdu.push_back (static_cast <char> (exception));
+    }
+
+    // transaction and protocol are echoed, the length covers unit and pdu
+    response->append (request, 0, 4);
+    PutUINT16 (pdu.size () + 1, response);
+    response->push_back (request[6]);
+    response->append (pdu);
+}  // end Respond
+
+// Read Holding Registers
+// - function 0x03, returns the modbus exception code or 0
+uint8_t SunSpecServer::ReadHoldingRegisters (const uint8_t* data,
+                                             const unsigned int length,
+                                             std::string* response) {
+    if (length != 4) {
+        return kIllegalDataValue;
+    }
+    unsigned int count = GetUINT16 (data + 2);
+    if (count == 0 || count > kMaxReadRegisters) {
+        return kIllegalDataValue;
+    }
+
+    uint16_t registers[kMaxReadRegisters];
+    if (!SunSpecServer::ReadRegisters (GetUINT16 (data), count, registers)) {
+        return kIllegalDataAddress;
+    }
+    response->push_back (static_cast <char> (2*count));
+    for (unsigned int i = 0; i < count; i++) {
+        PutUINT16 (registers[i], response);
+    }
+    return 0;
+}  // end Read Holding Registers
+
+// Write Registers
+// - queue a write for the next Publish if every register belongs to a rw
+// - point, returns the modbus exception code or 0
+uint8_t SunSpecServer::WriteRegisters (const unsigned int address,
+                                       const uint8_t* data,
+                                       const unsigned int count) {
+    if (address < base_ || address - base_ + count > writable_.size ()) {
+        return kIllegalDataAddress;
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        if (!writable_[address - base_ + i]) {
+            return kIllegalDataAddress;
+        }
+    }
+
+    Write write;
+    write.address = address;
+    write.registers.resize (count);
+    for (unsigned int i = 0; i < count; i++) {
+        write.registers[i] = GetUINT16 (data + 2*i);
+    }
+
+    std::lock_guard <std::mutex> lock (writes_mutex_);
+    if (writes_.size () >= max_writes_) {
+        return kServerDeviceBusy;
+    }
+    writes_.push_back (std::move (write));
+    return 0;
+}  // end Write Registers
+
+// Map
+// - find a point of a served model
+SunSpecServer::MappedPoint SunSpecServer::Map (const unsigned int did,
+                                               const std::string& id) {
+    for (unsigned int i = 0; i < models_.size (); i++) {
+        if (models_[i] == did) {
+            int index = models_[i].FindPoint (id);
+            if (index >= 0) {
+                return {static_cast <int> (i), index};
+            }
+        }
+    }
+    return {-1, -1};
+}  // end Map
+
+// Set Value
+// - encode one point into the image, scaled by the model's scale factors
+void SunSpecServer::SetValue (const MappedPoint& point, const double value) {
+    if (point.model < 0) {
+        return;
+    }
+    SunSpecModel& model = models_[point.model];
+    uint16_t* block = &image_[model.offset_ - base_];
+    const SunSpecModel::Point& data = model.GetPoints ()[point.index];
+    model.EncodePoint (point.index, value, std::string (),
+                       block, model.length_, block + data.offset);
+}  // end Set Value
+
+// Get Value
+// - decode one point from the image, NaN if the model is not served
+double SunSpecServer::GetValue (const MappedPoint& point) {
+    if (point.model < 0) {
+        return std::nan ("");
+    }
+    SunSpecModel& model = models_[point.model];
+    SunSpecModel::Values& values = values_[point.model];
+    model.Decode (&image_[model.offset_ - base_], model.length_, &values);
+    return values.number[point.index];
+}  // end Get Value
+
+bool SunSpecServer::Touches (const Write& write, const MappedPoint& point) {
+    if (point.model < 0) {
+        return false;
+    }
+    SunSpecModel& model = models_[point.model];
+    const SunSpecModel::Point& data = model.GetPoints ()[point.index];
+    unsigned int begin = model.offset_ + data.offset;
+    return write.address < begin + data.length
+           && begin < write.address + write.registers.size ();
+}
+
+// Control
+// - storage control written by a client. Charging wins over discharging
+// - like in the resource loop and rates are percent of the rated power,
+// - limited to 100. Without a mode or with a zero rate the resource idles.
+void SunSpecServer::Control (DistributedEnergyResource* der) {
+    double mode = SunSpecServer::GetValue (control_mode_);
+    double charge = std::min (SunSpecServer::GetValue (charge_rate_), 100.0);
+    double discharge = std::min (SunSpecServer::GetValue (discharge_rate_),
+                                 100.0);
+    unsigned int bits = std::isnan (mode) ? 0 : mode;
+
+    if ((bits & kCharge) && charge > 0) {
+        der->SetImportWatts (der->GetRatedImportPower () * charge / 100);
+    } else if ((bits & kDischarge) && discharge > 0) {
+        der->SetExportWatts (der->GetRatedExportPower () * discharge / 100);
+    } else {
+        der->SetImportWatts (0);
+    }
+
+    // clients read back the rates in effect
+    if (!std::isnan (charge)) {
+        SunSpecServer::SetValue (charge_rate_, charge);
+    }
+    if (!std::isnan (discharge)) {
+        SunSpecServer::SetValue (discharge_rate_, discharge);
+    }
+}  // end Control
+
+// Store
+// - sequence lock writer, the sequence is odd while the image is copied
+void SunSpecServer::Store () {
+    unsigned int sequence = sequence_.load (std::memory_order_relaxed);
+    sequence_.store (sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+    for (unsigned int i = 0; i < image_.size (); i++) {
+        snapshot_[i].store (image_[i], std::memory_order_relaxed);
+    }
+    sequence_.store (sequence + 2, std::memory_order_release);
+}  // end Store
@@ -8,7 +8,7 @@ class DistributedEnergyResource {
         // constructor / destructor
         DistributedEnergyResource (tsu::string_map init);
         virtual ~DistributedEnergyResource ();
-        virtual void Loop (float delta_time);
+        virtual void Loop (double delta_time);
 
 
     public:
@@ -31,12 +31,14 @@ class DistributedEnergyResource {
     public:
         // get export methods
         unsigned int GetRatedExportPower ();
+        unsigned int GetRatedExportEnergy ();
         unsigned int GetExportPower ();
         unsigned int GetExportEnergy ();
         unsigned int GetExportRamp ();
 
         // get import methods
         unsigned int GetRatedImportPower ();
+        unsigned int GetRatedImportEnergy ();
         unsigned int GetImportPower ();
         unsigned int GetImportEnergy ();
         unsigned int GetImportRamp ();
@@ -44,6 +46,12 @@ class DistributedEnergyResource {
         // get idle methods
         unsigned int GetIdleLosses ();
 
+        // get unrounded dynamic properties
+        double GetUnroundedExportPower ();
+        double GetUnroundedExportEnergy ();
+        double GetUnroundedImportPower ();
+        double GetUnroundedImportEnergy ();
+
     private:
         // controls
         virtual void ImportPower ();
@@ -66,16 +74,17 @@ class DistributedEnergyResource {
 
     private:
         // dynamic properties
-        float export_power_;
-        float export_energy_;
-        float import_power_;
-        float import_energy_;     
+        double export_power_;
+        double export_energy_;
+        double import_power_;
+        double import_energy_;
 
     private:
         // control properties
         unsigned int export_watts_;
         unsigned int import_watts_;
-        float delta_time_;  // milliseconds
+        double delta_seconds_;  // time step of the current loop
+        double delta_hours_;
 };
 
 #endif // DISTRIBUTEDENERGYRESOURCE_H
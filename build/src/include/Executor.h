@@ -0,0 +1,95 @@
+#ifndef EXECUTOR_H_
+#define EXECUTOR_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+
+// Executor
+// - runs periodic tasks, each on its own thread, against absolute
+// - deadlines so the period does not drift with the execution time.
+// - A task that overruns skips the deadlines it missed instead of running
+// - back to back. Each task keeps its wake up jitter, execution time and
+// - missed deadline statistics.
+// - Example:
+//  Executor executor;
+//  executor.AddTask ("DER", std::chrono::milliseconds (500),
+//      [&] (double delta_ms) { der_ptr->Loop (delta_ms); });
+//  executor.Start ();
+class Executor {
+public:
+    typedef std::chrono::steady_clock clock;
+
+    // the task is given the milliseconds since its previous run started
+    typedef std::function <void (double)> task;
+
+    // upper bounds (us) of the jitter histogram bins, the last bin is open
+    static const std::vector <double> kJitterBins;
+
+    // Task Status
+    // - statistics shown by the command line interface
+    struct TaskStatus {
+        std::string name;
+        double period_ms;
+        unsigned long runs;
+        unsigned long missed;               // deadlines skipped by overruns
+        std::vector <unsigned long> jitter; // counts per kJitterBins bin
+        double jitter_max_us;
+        double exec_p50_ms;
+        double exec_p99_ms;
+        double exec_max_ms;
+    };
+
+public:
+    Executor ();
+    ~Executor ();
+
+    void AddTask (const std::string& name,
+                  clock::duration period,
+                  task function);
+
+    void Start ();
+
+    void Stop ();
+
+    std::vector <TaskStatus> GetStatus ();
+
+private:
+    // Task
+    // - execution times are kept in a window of the most recent runs for
+    // - the percentiles
+    struct Task {
+        std::string name;
+        clock::duration period;
+        task function;
+        std::mutex mutex;       // guards the statistics
+        unsigned long runs;
+        unsigned long missed;
+        std::vector <unsigned long> jitter;
+        double jitter_max_us;
+        std::vector <double> exec_ms;
+        double exec_max_ms;
+    };
+
+private:
+    void Run (Task* task);
+
+    void Record (Task* task,
+                 double jitter_us,
+                 double exec_ms,
+                 unsigned long missed);
+
+private:
+    std::mutex mutex_;
+    std::condition_variable stop_;
+    std::vector <std::unique_ptr <Task>> tasks_;
+    std::vector <std::thread> threads_;
+    bool running_;
+};
+
+#endif // EXECUTOR_H_
@@ -0,0 +1,126 @@
+#ifndef LOGWRITER_H_
+#define LOGWRITER_H_
+
+#include <string>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <fstream>
+#include <ctime>
+
+#include "tsu.h"
+
+// Log Writer
+// - process wide backend of the Logger. Producers push records into a
+// - bounded ring buffer without taking a lock and a single background
+// - thread writes them in batches to one open file per context, so logging
+// - never touches the filesystem on the calling thread. Files are named
+// - <directory><device>_<context>_<date>.log and rotate when the date
+// - changes. When the ring is full records are dropped and counted, or the
+// - producer waits for space if the overflow policy is "block".
+// - Example:
+//  LogWriter::Instance ().Configure (ini_map["Logger"]);
+//  Logger("INFO") << "Data\t" << "More Data";
+class LogWriter {
+public:
+    typedef std::chrono::system_clock clock;
+
+    enum class Overflow {
+        DROP,
+        BLOCK
+    };
+
+    // Record
+    // - one log line, the timestamp is formatted by the writer thread
+    struct Record {
+        clock::time_point time;
+        std::string context;
+        std::string message;
+    };
+
+public:
+    static LogWriter& Instance ();
+
+    void Configure (tsu::string_map& init);
+
+    bool Push (Record&& record);
+
+    void Flush ();
+
+    void Stop ();
+
+    unsigned long GetDropped ();
+
+private:
+    LogWriter ();
+    ~LogWriter ();
+    LogWriter (const LogWriter&) = delete;
+    LogWriter& operator = (const LogWriter&) = delete;
+
+    // Slot
+    // - ring buffer cell, the sequence tells producers and the writer
+    // - whose turn it is to use the cell
+    struct Slot {
+        std::atomic <size_t> sequence;
+        Record record;
+    };
+
+    // Log File
+    // - open file of one context and the date it was opened for
+    struct LogFile {
+        std::ofstream stream;
+        std::string date;
+    };
+
+private:
+    void Start ();
+
+    void Resize (size_t capacity);
+
+    bool Pop (Record* record);
+
+    void Writer ();
+
+    void Write (const Record& record);
+
+    LogFile* GetFile (const std::string& context, const std::string& date);
+
+    const std::string& FormatTime (const clock::time_point& time);
+
+private:
+    // ring buffer, head is claimed by producers and tail only moves on
+    // the writer thread
+    std::unique_ptr <Slot[]> slots_;
+    size_t mask_;
+    std::atomic <size_t> head_;
+    std::atomic <size_t> tail_;
+    std::atomic <unsigned long> dropped_;         // since the last report
+    std::atomic <unsigned long> dropped_total_;
+
+    // writer thread
+    std::once_flag started_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable flushed_;
+    std::atomic <bool> running_;
+    size_t written_;    // records handled by the writer, guarded by mutex_
+
+    // settings, guarded by mutex_
+    std::string directory_;
+    std::string device_;
+    std::atomic <Overflow> overflow_;
+    std::chrono::milliseconds interval_;
+    std::atomic <bool> reopen_;     // directory or device changed
+
+    // writer thread only
+    std::map <std::string, std::unique_ptr <LogFile>> files_;
+    std::time_t time_cached_;
+    std::string time_text_;
+};
+
+#endif // LOGWRITER_H_
@@ -2,9 +2,13 @@
 #define _LOGGER_H_INCLUDED_
 #include <string>
 #include <sstream>
+#include <chrono>
+#include <cstdio>
 
 // Logger
 // - simple create inline and load with context then use "<<" to add arguments to log.
+// - The finished line is handed to the LogWriter when the logger goes out of
+// - scope, the file is written on the writer thread.
 // - Example:
 //	Logger("INFO") << "Data\t" << "More Data";
 class Logger {
@@ -15,18 +19,53 @@ public:
 
 	// Operator Overloads
 	template <typename T>
-	Logger& operator << (T rhs) {
-		std::stringstream ss;
+	Logger& operator << (const T& rhs) {
+		std::ostringstream ss;
 		ss << rhs;
 		msg_ += ss.str();
 		return *this;
 	};
+
+	// strings are appended without a stream
+	Logger& operator << (const std::string& rhs) {
+		msg_ += rhs;
+		return *this;
+	};
+
+	Logger& operator << (const char* rhs) {
+		msg_ += rhs;
+		return *this;
+	};
+
+	Logger& operator << (char rhs) {
+		msg_ += rhs;
+		return *this;
+	};
+
+	// numbers are formatted into the record without a stream
+	Logger& operator << (int rhs) { return Logger::Append ("%d", rhs); };
+	Logger& operator << (unsigned int rhs) { return Logger::Append ("%u", rhs); };
+	Logger& operator << (long rhs) { return Logger::Append ("%ld", rhs); };
+	Logger& operator << (unsigned long rhs) { return Logger::Append ("%lu", rhs); };
+	Logger& operator << (long long rhs) { return Logger::Append ("%lld", rhs); };
+	Logger& operator << (unsigned long long rhs) { return Logger::Append ("%llu", rhs); };
+	Logger& operator << (double rhs) { return Logger::Append ("%g", rhs); };
+	Logger& operator << (float rhs) { return Logger::Append ("%g", double (rhs)); };
+
 private:
+	template <typename T>
+	Logger& Append (const char* format, T rhs) {
+		char buffer[32];
+		int length = std::snprintf (buffer, sizeof(buffer), format, rhs);
+		if (length > 0) {
+			msg_.append (buffer, length);
+		}
+		return *this;
+	};
+
+	std::chrono::system_clock::time_point time_;
 	std::string msg_;
 	std::string context_;
-
-private:
-	void ToFile ();
 };
 
 #endif // LOGGER_H_INCLUDED
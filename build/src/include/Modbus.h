@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <mutex>
 
 // Modbus Includes
 #include <modbus/modbus-tcp.h>
@@ -11,14 +12,25 @@
 #include "tsu.h"
 
 class Modbus {
+public:
+    // Read Request
+    // - one modbus read transaction of the poll plan
+    struct ReadRequest {
+        unsigned int offset;
+        unsigned int length;
+    };
+
 public:
     Modbus (tsu::string_map& init);
     ~Modbus ();
-    void Querry ();
-    void ReadRegisters (unsigned int offset,
+    bool Connect ();
+    void Close ();
+    bool IsConnected ();
+    bool Querry ();
+    bool ReadRegisters (unsigned int offset,
                         unsigned int length,
                         uint16_t *reg_ptr);
-    void WriteRegisters (unsigned int offset,
+    bool WriteRegisters (unsigned int offset,
                          unsigned int length,
                          const uint16_t *reg_ptr);
 
@@ -26,10 +38,77 @@ public:
 
     void WriteModel (const unsigned int did, tsu::string_map model);
 
+    // coalesced writes
+    bool SetPoint (const unsigned int did,
+                   const std::string& id,
+                   const double value);
+
+    bool SetPoint (const unsigned int did,
+                   const std::string& id,
+                   const std::string& value);
+
+    bool Flush ();
+
+    bool HasPending ();
+
+    // poll plan
+    bool PollModels ();
+
+    bool PollModels (const std::vector <unsigned int>& dids);
+
+    const SunSpecModel::Values* GetValues (const unsigned int did);
+
+    const std::vector <ReadRequest>& GetReadPlan ();
+
+    const std::vector <SunSpecModel>& GetModels ();
+
+    static std::vector <ReadRequest> PlanReads (
+        const std::vector <SunSpecModel>& models
+    );
+
+private:
+    bool FindBase (unsigned int* base);
+    void AddModel (const unsigned int did,
+                   const unsigned int offset,
+                   const unsigned int length,
+                   std::vector <SunSpecModel>* models);
+    bool ReadBlock (unsigned int offset,
+                    unsigned int length,
+                    uint16_t *reg_ptr);
+    void BuildPlan ();
+    bool PollSelected ();
+    bool SetPoint (const unsigned int did,
+                   const std::string& id,
+                   const double value,
+                   const std::string& text);
+    bool StagePoint (const SunSpecModel& model,
+                     const unsigned int index,
+                     const double value,
+                     const std::string& text);
+
 private:
     unsigned int sunspec_key_;
     modbus_t* context_ptr_;
+    bool connected_;
     std::vector <SunSpecModel> models_;
+
+    // poll plan and the register image it reads into
+    std::vector <ReadRequest> read_plan_;
+    std::vector <unsigned int> model_requests_;  // first, last per model
+    std::vector <bool> request_status_;
+    std::vector <bool> request_needed_;
+    std::vector <bool> model_selected_;
+    std::vector <bool> model_read_;         // scale factors are in the image
+    unsigned int image_offset_;
+    std::vector <uint16_t> image_;
+    std::vector <SunSpecModel::Values> values_;
+    std::vector <uint16_t> read_buffer_;
+
+    // pending writes, guarded by the mutex along with the models and image
+    std::mutex mutex_;
+    std::vector <uint16_t> pending_;
+    std::vector <bool> dirty_;
+    unsigned int dirty_count_;
 };
 
 #endif // MODBUS_H_
@@ -0,0 +1,122 @@
+#ifndef POLLER_H_
+#define POLLER_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+
+#include "Modbus.h"
+#include "tsu.h"
+
+// Poller
+// - drives many modbus devices from a fixed pool of worker threads.
+// - Each device has its own poll schedule and is only ever handled by one
+// - worker at a time, so a slow or dead device only holds up itself.
+// - Devices that stop responding are closed and reconnected with an
+// - exponential backoff.
+// - Example:
+//  Poller poller (ini_map["Poller"]);
+//  poller.AddDevice ("BMS", ini_map["BMS"]);
+//  poller.Start ();
+class Poller {
+public:
+    typedef std::chrono::steady_clock clock;
+
+    // called on the worker after every successful poll with the device
+    // name, its client and how long the poll took (ms)
+    typedef std::function <void (const std::string&, Modbus*, double)>
+        callback;
+
+    // Device Status
+    // - counters shown by the command line interface
+    struct DeviceStatus {
+        std::string name;
+        bool connected;
+        unsigned long polls;
+        unsigned long failures;
+        unsigned long reconnects;
+        double last_ms;     // duration of the last poll
+        double max_ms;      // longest poll
+    };
+
+public:
+    Poller (tsu::string_map& init);
+    ~Poller ();
+
+    void AddDevice (const std::string& name, tsu::string_map& init);
+
+    void SetCallback (callback on_poll);
+
+    bool SetPoint (const std::string& name,
+                   const unsigned int did,
+                   const std::string& id,
+                   const double value);
+
+    void Start ();
+
+    void Stop ();
+
+    std::vector <DeviceStatus> GetStatus ();
+
+private:
+    // Schedule
+    // - poll period of one model, did 0 polls every model of the device
+    struct Schedule {
+        unsigned int did;
+        clock::duration period;
+        clock::time_point due;
+    };
+
+    struct Device {
+        std::string name;
+        std::string host;
+        tsu::string_map init;
+        std::unique_ptr <Modbus> modbus;
+        std::vector <Schedule> schedules;
+        clock::time_point next;
+        clock::duration backoff;
+        bool busy;
+        bool pending;           // writes waiting to be flushed
+        unsigned int errors;    // consecutive failed polls
+        DeviceStatus status;
+    };
+
+private:
+    void Worker ();
+
+    Device* NextDevice (clock::time_point* wake);
+
+    void Service (Device* device);
+
+    bool Reconnect (Device* device);
+
+    void Backoff (Device* device, clock::time_point now);
+
+    void Reschedule (Device* device);
+
+    void Disconnect (Device* device, clock::time_point now);
+
+private:
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::vector <std::unique_ptr <Device>> devices_;
+    std::map <std::string, unsigned int> host_inflight_;
+    std::vector <std::thread> threads_;
+    callback on_poll_;
+    bool running_;
+
+    // settings
+    unsigned int thread_count_;
+    unsigned int host_limit_;       // concurrent devices per ip address
+    unsigned int retries_;          // failed polls before reconnecting
+    clock::duration backoff_min_;
+    clock::duration backoff_max_;
+};
+
+#endif // POLLER_H_
@@ -0,0 +1,94 @@
+#ifndef RESOURCEFLEET_H_
+#define RESOURCEFLEET_H_
+
+#include <vector>
+#include <cstddef>
+
+#include "tsu.h"
+
+// Resource Fleet
+// - many DistributedEnergyResource units stepped together. Every property
+// - is kept in its own array so a step is a branch free loop over the fleet
+// - that the compiler can vectorize. Units are independent, so the fleet is
+// - split into contiguous ranges, one per thread, and every thread of Run
+// - runs all the steps of its range. Loop takes a single step on the calling
+// - thread. Results do not depend on the thread count and
+// - match DistributedEnergyResource::Loop with the same time step.
+// - Example:
+//  ResourceFleet fleet (ini_map["DER"], 100000);
+//  fleet.SetImportWatts (0, 2000);
+//  fleet.Run (500, 7200);      // one hour in 500 ms steps
+//  double watts = fleet.GetTotalImportPower ();
+class ResourceFleet {
+public:
+    ResourceFleet (tsu::string_map init, const size_t units);
+    virtual ~ResourceFleet ();
+
+    void SetThreads (const unsigned int threads);
+
+    // steps of delta_time milliseconds
+    void Loop (const double delta_time);
+
+    void Run (const double delta_time, const unsigned int steps);
+
+public:
+    // unit controls, same rules as DistributedEnergyResource
+    void SetExportWatts (const size_t unit, unsigned int power);
+    void SetImportWatts (const size_t unit, unsigned int power);
+
+    void SetRatedExportPower (const size_t unit, unsigned int watts);
+    void SetRatedExportEnergy (const size_t unit, unsigned int watt_hours);
+    void SetExportRamp (const size_t unit, unsigned int watts_per_second);
+    void SetRatedImportPower (const size_t unit, unsigned int watts);
+    void SetRatedImportEnergy (const size_t unit, unsigned int watt_hours);
+    void SetImportRamp (const size_t unit, unsigned int watts_per_second);
+    void SetIdleLosses (const size_t unit, unsigned int energy_per_hour);
+
+public:
+    size_t GetUnits ();
+
+    // unit state, unrounded
+    double GetExportPower (const size_t unit);
+    double GetExportEnergy (const size_t unit);
+    double GetImportPower (const size_t unit);
+    double GetImportEnergy (const size_t unit);
+
+    // fleet totals
+    double GetTotalExportPower ();
+    double GetTotalExportEnergy ();
+    double GetTotalImportPower ();
+    double GetTotalImportEnergy ();
+
+private:
+    void Steps (const size_t begin,
+                const size_t end,
+                const double seconds,
+                const unsigned int steps);
+
+    double Total (const std::vector <double>& property);
+
+private:
+    size_t units_;
+    unsigned int threads_;
+
+    // rated properties
+    std::vector <double> rated_export_power_;   // (W)
+    std::vector <double> rated_export_energy_;  // (Wh)
+    std::vector <double> export_ramp_;          // (W s^-1)
+    std::vector <double> rated_import_power_;   // (W)
+    std::vector <double> rated_import_energy_;  // (Wh)
+    std::vector <double> import_ramp_;          // (W s^-1)
+    std::vector <double> idle_losses_;          // (Wh h^-1)
+
+    // dynamic properties
+    std::vector <double> export_power_;
+    std::vector <double> export_energy_;
+    std::vector <double> import_power_;
+    std::vector <double> import_energy_;
+
+    // control properties
+    std::vector <double> export_watts_;
+    std::vector <double> import_watts_;
+};
+
+#endif // RESOURCEFLEET_H_
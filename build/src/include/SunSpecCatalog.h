@@ -0,0 +1,81 @@
+#ifndef SUNSPECCATALOG_H
+#define SUNSPECCATALOG_H
+
+#include <string>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <cstdint>
+
+#include "SunSpecModel.h"
+
+// SunSpec Catalog
+// - process wide store of smdx model definitions keyed by did.
+// - Each model is loaded the first time a device asks for it and shared
+// - read only after that. Models come from a binary catalog when one is
+// - open, otherwise from the smdx xml files in the configured directory.
+// - Example:
+//  SunSpecCatalog::Instance ().SetPath ("../data/models/smdx");
+//  SunSpecCatalog::Instance ().OpenBinary ("../data/models/smdx.cat");
+class SunSpecCatalog {
+public:
+    static SunSpecCatalog& Instance ();
+
+    void SetPath (const std::string& path);
+
+    bool OpenBinary (const std::string& filename);
+
+    void CloseBinary ();
+
+    std::shared_ptr <const SunSpecModel::Definition> GetDefinition (
+        const unsigned int did
+    );
+
+    std::shared_ptr <const SunSpecModel::Table> GetTable (
+        const unsigned int did,
+        const unsigned int length
+    );
+
+    // binary catalog creation
+    std::vector <unsigned int> ReadManifest ();
+
+    bool WriteBinary (const std::string& filename,
+                      const std::vector <unsigned int>& dids);
+
+private:
+    SunSpecCatalog ();
+    ~SunSpecCatalog ();
+    SunSpecCatalog (const SunSpecCatalog&) = delete;
+    SunSpecCatalog& operator = (const SunSpecCatalog&) = delete;
+
+    std::shared_ptr <const SunSpecModel::Definition> Load (
+        const unsigned int did
+    );
+
+    std::shared_ptr <const SunSpecModel::Definition> LoadXml (
+        const unsigned int did
+    );
+
+    std::shared_ptr <const SunSpecModel::Definition> LoadBinary (
+        const unsigned int did
+    );
+
+private:
+    std::mutex mutex_;
+    std::string path_;
+
+    // binary catalog, the index maps a did to its record offset and size
+    std::ifstream binary_;
+    size_t binary_size_;
+    std::map <unsigned int, std::pair <uint32_t, uint32_t>> index_;
+
+    std::map <unsigned int,
+              std::shared_ptr <const SunSpecModel::Definition>> definitions_;
+    std::map <std::pair <unsigned int, unsigned int>,
+              std::shared_ptr <const SunSpecModel::Table>> tables_;
+};
+
+#endif // SUNSPECCATALOG_H
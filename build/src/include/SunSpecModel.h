@@ -4,17 +4,96 @@
 #include <string>
 #include <vector>
 #include <map>
-
-// BOOST Libs
-#include <boost/property_tree/ptree.hpp>
-#include <boost/property_tree/xml_parser.hpp>
-#include <boost/foreach.hpp>
+#include <memory>
+#include <cstdint>
 
 // SunSpec Model
-// - This model uses boosts property tree to parse the xml models for
-// - modbus register blocks.
-// - https://www.technical-recipes.com/2014/using-boostproperty_tree/
+// - A modbus register block described by a SunSpec smdx model. The model
+// - definition and its compiled point table are shared through the
+// - SunSpecCatalog so each device only stores its offset and a pointer.
 class SunSpecModel {
+public:
+    // Point Type
+    // - smdx point types, grouped by the number of registers they occupy
+    enum class PointType : uint8_t {
+        INT16, UINT16, COUNT, ACC16, ENUM16, BITFIELD16, SUNSSF,
+        INT32, UINT32, ACC32, FLOAT32, ENUM32, BITFIELD32, IPADDR,
+        INT64, UINT64, ACC64,
+        STRING, IPV6ADDR, EUI48
+    };
+
+    // Point
+    // - compiled point descriptor, offsets are relative to the model start
+    // - sf_register is the offset of the sunssf register used to scale the
+    // - point (-1 when the point is unscaled or uses sf_fixed).
+    struct Point {
+        uint16_t offset;
+        uint16_t length;
+        PointType type;
+        bool writable;          // access="rw"
+        int16_t sf_register;
+        double sf_fixed;
+        uint32_t symbol_begin;  // [begin, end) into the symbol table
+        uint32_t symbol_end;
+    };
+
+    // Symbol
+    // - enum value or bitfield bit mapped to an interned symbol name
+    struct Symbol {
+        uint32_t value;
+        uint32_t id;
+    };
+
+    // Point Definition
+    // - point as read from the smdx file before scale factors are resolved
+    struct PointDefinition {
+        std::string id;
+        std::string sf;
+        PointType type;
+        bool writable;
+        uint16_t offset;
+        uint16_t length;
+        uint32_t symbol_begin;
+        uint32_t symbol_end;
+    };
+
+    // Definition
+    // - immutable smdx model shared by every device that implements it
+    struct Definition {
+        unsigned int did;
+        unsigned int length;
+        unsigned int fixed_length;
+        unsigned int repeating_length;
+        std::string name;
+        std::string repeating_name;
+        std::vector <PointDefinition> fixed;
+        std::vector <PointDefinition> repeating;
+        std::vector <Symbol> symbols;
+        std::vector <std::string> symbol_names;
+    };
+
+    // Table
+    // - point table of a definition expanded for a model length, the
+    // - length decides how many repeating blocks are present.
+    struct Table {
+        std::shared_ptr <const Definition> definition;
+        unsigned int length;
+        std::vector <Point> points;
+        std::vector <std::string> names;
+        std::map <std::string, unsigned int> index;
+    };
+
+    // Values
+    // - typed decode target, indexed the same as the point table.
+    // - number holds the scaled value (raw value for enums and bitfields),
+    // - symbol the interned enum symbol id (-1 if none) and text the value
+    // - of string like points. NaN marks a point without a value.
+    struct Values {
+        std::vector <double> number;
+        std::vector <int32_t> symbol;
+        std::vector <std::string> text;
+    };
+
 public:
     SunSpecModel (unsigned int did, unsigned int offset);
     virtual ~SunSpecModel ();
@@ -28,6 +107,51 @@ public:
         std::map <std::string, std::string>& points
     );
 
+    // compiled interface
+    Values NewValues () const;
+
+    void Decode (const uint16_t* register_block,
+                 const unsigned int length,
+                 Values* values) const;
+
+    void Encode (const Values& values,
+                 std::vector <uint16_t>* register_block) const;
+
+    bool EncodePoint (const unsigned int index,
+                      double value,
+                      const std::string& text,
+                      const uint16_t* scalers,
+                      const unsigned int scalers_length,
+                      uint16_t* registers) const;
+
+    std::map <std::string, std::string> ValuesToPoints (
+        const Values& values
+    ) const;
+
+    void PointsToValues (const std::map <std::string, std::string>& points,
+                         Values* values) const;
+
+    bool ParsePoint (const unsigned int index,
+                     const std::string& data,
+                     double* number,
+                     int32_t* symbol,
+                     std::string* text) const;
+
+    int FindPoint (const std::string& id) const;
+
+    const std::vector <Point>& GetPoints () const;
+
+    const std::string& GetPointName (const unsigned int index) const;
+
+    const std::string& GetSymbolName (const int32_t id) const;
+
+    static std::shared_ptr <const Table> Expand (
+        const std::shared_ptr <const Definition>& definition,
+        const unsigned int length
+    );
+
+    void SetLength (const unsigned int length);
+
     unsigned int GetLength ();
 
     unsigned int GetOffset ();
@@ -37,41 +161,13 @@ public:
         return did_ == did;
     };
 
-private:
-    // utility methods
-    void GetScalers ();
-
-    float BlockToScaler (
-        const std::vector <uint16_t>& register_block,
-        std::string scaler
-    );
-
-    float PointsToScaler (
-        std::map <std::string, std::string>& points,
-        std::string scaler
-    );
-
-    // converter registers to larger values
-    uint32_t GetUINT32 (const std::vector <uint16_t>& block,
-                        const unsigned int index);
-    uint64_t GetUINT64 (const std::vector <uint16_t>& block,
-                        const unsigned int index);
-    std::string GetString (const std::vector <uint16_t>& block,
-                           const unsigned int index,
-                           const unsigned int length);
-    void SetUINT32 (std::vector <uint16_t>* block,
-                    const unsigned int index,
-                    const uint32_t value);
-    void SetUINT64 (std::vector <uint16_t>* block,
-                    const unsigned int index,
-                    const uint64_t value);
-
 public:
     unsigned int offset_;
     unsigned int length_;
     unsigned int did_;
-    boost::property_tree::ptree smdx_;
-    std::map <std::string, int16_t> scalers_;
+
+private:
+    std::shared_ptr <const Table> table_;
 };
 
 #endif // SUNSPECMODEL_H
@@ -0,0 +1,159 @@
+#ifndef SUNSPECSERVER_H_
+#define SUNSPECSERVER_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#include "SunSpecModel.h"
+#include "DistributedEnergyResource.hpp"
+#include "tsu.h"
+
+// SunSpec Server
+// - modbus tcp server publishing a SunSpec register map. The resource task
+// - calls Publish after each loop, which copies the resource state into the
+// - models and stores the register image behind a sequence lock. Clients
+// - are served from one epoll thread that reads the image without ever
+// - waiting on the resource task, and the resource task only ever tries the
+// - lock of the write queue, so neither side blocks the other.
+// - Writes are queued and applied by the next Publish, a write that touches
+// - a register of a point without access="rw" is refused. Writes to the
+// - storage control model (124) set the import or export watts of the
+// - resource and a write to its WChaMax sets the rated import power, never
+// - above the rating the resource was first published with.
+// - Example:
+//  SunSpecServer server (ini_map["Server"]);
+//  server.AddModel (1, ini_map["Server.1"]);
+//  server.AddModel (802, ini_map["Server.802"]);
+//  server.Start ();
+//  ...
+//  server.Publish (der_ptr);     // from the resource task
+class SunSpecServer {
+public:
+    SunSpecServer (tsu::string_map& init);
+    ~SunSpecServer ();
+
+    // points holds the initial values of the model by point id
+    void AddModel (const unsigned int did, tsu::string_map& points);
+
+    bool Start ();
+
+    void Stop ();
+
+    void Publish (DistributedEnergyResource* der);
+
+    bool ReadRegisters (const unsigned int address,
+                        const unsigned int length,
+                        uint16_t* registers);
+
+    unsigned long GetRequests ();
+
+private:
+    // Mapped Point
+    // - point of a served model, index is -1 if the model is not served
+    struct MappedPoint {
+        int model;
+        int index;
+    };
+
+    // Write
+    // - registers written by a client, waiting for the next Publish
+    struct Write {
+        unsigned int address;
+        std::vector <uint16_t> registers;
+    };
+
+    struct Client {
+        int socket;
+        std::string input;
+        std::string output;
+        bool blocked;       // waiting for the socket to take more output
+    };
+
+private:
+    void Serve ();
+
+    void Accept ();
+
+    bool Receive (Client* client);
+
+    bool Send (Client* client);
+
+    void Respond (const std::string& request, std::string* response);
+
+    uint8_t ReadHoldingRegisters (const uint8_t* data,
+                                  const unsigned int length,
+                                  std::string* response);
+
+    uint8_t WriteRegisters (const unsigned int address,
+                            const uint8_t* data,
+                            const unsigned int count);
+
+    MappedPoint Map (const unsigned int did, const std::string& id);
+
+    void SetValue (const MappedPoint& point, const double value);
+
+    double GetValue (const MappedPoint& point);
+
+    bool Touches (const Write& write, const MappedPoint& point);
+
+    void Control (DistributedEnergyResource* der);
+
+    void Store ();
+
+private:
+    // settings
+    int port_;
+    unsigned int base_;
+    unsigned int max_clients_;
+    unsigned int max_writes_;
+
+    std::vector <SunSpecModel> models_;
+    std::vector <SunSpecModel::Values> values_;
+
+    // register image from the base address, only touched by Publish
+    std::vector <uint16_t> image_;
+
+    // registers of rw points, read only once the server thread runs
+    std::vector <bool> writable_;
+
+    // WChaMax limit, the rated import power of the first Publish
+    double import_limit_;
+
+    // image shared with the server thread, even sequence when consistent
+    std::atomic <unsigned int> sequence_;
+    std::vector <std::atomic <uint16_t>> snapshot_;
+
+    // writes waiting for the next Publish
+    std::mutex writes_mutex_;
+    std::vector <Write> writes_;
+    std::vector <Write> applying_;
+
+    // resource points
+    MappedPoint rated_energy_;
+    MappedPoint rated_import_;
+    MappedPoint rated_export_;
+    MappedPoint state_of_charge_;
+    MappedPoint charge_status_;
+    MappedPoint watts_;
+    MappedPoint max_charge_;
+    MappedPoint control_mode_;
+    MappedPoint charge_rate_;
+    MappedPoint discharge_rate_;
+    MappedPoint charge_state_;
+    MappedPoint storage_status_;
+
+    // server thread
+    int listener_;
+    int epoll_;
+    std::map <int, Client> clients_;
+    std::thread thread_;
+    std::atomic <bool> running_;
+    std::atomic <unsigned long> requests_;
+};
+
+#endif // SUNSPECSERVER_H_
@@ -40,6 +40,11 @@
 #include "include/tsu.h"
 #include "include/DistributedEnergyResource.hpp"
 #include "include/Modbus.h"
+#include "include/Poller.h"
+#include "include/SunSpecCatalog.h"
+#include "include/LogWriter.h"
+#include "include/Executor.h"
+#include "include/SunSpecServer.h"
 
 using namespace std;
 
@@ -54,13 +59,17 @@ static void Help () {
     printf ("> i <watts>    import power\n");
     printf ("> e <watts>    export power\n");
     printf ("> p            print properties\n");
+    printf ("> s            print device status\n");
+    printf ("> t            print task timing\n");
 } // end Help
 
 
 // Command Line Interface
 // - method to allow user controls during program run-time
 static bool CommandLineInterface (const string& input, 
-                                  DistributedEnergyResource *DER) {
+                                  DistributedEnergyResource *DER,
+                                  Poller *poller,
+                                  Executor *executor) {
     // check for program argument
     if (input == "") {
         return false;
@@ -106,6 +115,46 @@ static bool CommandLineInterface (const string& input,
             break;
         }
 
+        case 's': {
+            cout << "\n\t[Devices]\n";
+            for (auto& device : poller->GetStatus ()) {
+                cout << "\n" << device.name
+                    << "\tconnected: " << device.connected
+                    << "\tpolls: " << device.polls
+                    << "\tfailures: " << device.failures
+                    << "\treconnects: " << device.reconnects
+                    << "\tlast (ms): " << device.last_ms
+                    << "\tmax (ms): " << device.max_ms;
+            }
+            cout << endl;
+            break;
+        }
+
+        case 't': {
+            cout << "\n\t[Tasks]\n";
+            for (auto& task : executor->GetStatus ()) {
+                cout << "\n" << task.name
+                    << "\tperiod (ms): " << task.period_ms
+                    << "\truns: " << task.runs
+                    << "\tmissed: " << task.missed
+                    << "\texec p50/p99/max (ms): " << task.exec_p50_ms
+                    << " / " << task.exec_p99_ms
+                    << " / " << task.exec_max_ms
+                    << "\n\tjitter max (us): " << task.jitter_max_us
+                    << "\tjitter (us):";
+                for (unsigned int i = 0; i < task.jitter.size (); i++) {
+                    if (i < Executor::kJitterBins.size ()) {
+                        cout << "  <" << Executor::kJitterBins[i] << ": ";
+                    } else {
+                        cout << "  >=" << Executor::kJitterBins.back () << ": ";
+                    }
+                    cout << task.jitter[i];
+                }
+            }
+            cout << endl;
+            break;
+        }
+
         default: {
             Help();
             break;
@@ -115,28 +164,6 @@ static bool CommandLineInterface (const string& input,
     return false;
 }  // end Command Line Interface
 
-void ResourceLoop (DistributedEnergyResource *DER, unsigned int time_wait) {
-    unsigned int time_remaining, time_past;
-    auto time_start = chrono::high_resolution_clock::now();
-    auto time_end = chrono::high_resolution_clock::now();
-    chrono::duration<double, milli> time_elapsed;
-
-    while (!done) {
-        time_start = chrono::high_resolution_clock::now();
-            // time since last control call;
-            time_elapsed = time_start - time_end;
-            time_past = time_elapsed.count();
-            DER->Loop(time_past);
-        time_end = chrono::high_resolution_clock::now();
-        time_elapsed = time_end - time_start;
-
-        // determine sleep duration after deducting process time
-        time_remaining = (time_wait - time_elapsed.count());
-        time_remaining = (time_remaining > 0) ? time_remaining : 0;
-        this_thread::sleep_for (chrono::milliseconds (time_remaining));
-    }
-}  // end Resource Loop
-
 // Main
 // ----
 int main (int argc, char** argv) {
@@ -155,40 +182,84 @@ int main (int argc, char** argv) {
     string config_file = parameters.at("config");
     tsu::config_map ini_map = tsu::MapConfigFile(config_file);
 
+    // log files are written from a background thread from here on
+    LogWriter::Instance ().Configure (ini_map["Logger"]);
+
     cout << "\n\t\tLooking for resource...\n";
 
+    cout << "\n\t\tLoading SunSpec models...\n";
+    tsu::string_map& sunspec = ini_map["SunSpec"];
+    SunSpecCatalog& catalog = SunSpecCatalog::Instance ();
+    if (!sunspec["path"].empty ()) {
+        catalog.SetPath (sunspec["path"]);
+    }
+    if (!sunspec["catalog"].empty ()) {
+        // models missing from the catalog fall back to the xml files
+        catalog.OpenBinary (sunspec["catalog"]);
+    }
+
     DistributedEnergyResource *der_ptr = 
         new DistributedEnergyResource (ini_map["DER"]);
 
-    Modbus bms(ini_map["BMS"]);
-    Modbus inverter(ini_map["Inverter"]);
+    // the devices polled are listed in the poller section
+    Poller poller(ini_map["Poller"]);
+    for (auto& name : tsu::SplitString (ini_map["Poller"]["devices"], ',')) {
+        poller.AddDevice (name, ini_map[name]);
+    }
+    poller.Start ();
 
-    cout << "\n\t\tReadModel Test: \n";
-    tsu::string_map points = bms.ReadModel (99001);
-    for (auto& point : points) {
-        cout << point.first << "\t" << point.second << "\n";
+    // the resource state is served to modbus clients when the server
+    // section is present, models=<did>,... are initialized from the
+    // Server.<did> sections
+    bool serve = ini_map.count ("Server") > 0;
+    SunSpecServer *server_ptr = nullptr;
+    if (serve) {
+        cout << "\n\t\tStarting SunSpec server...\n";
+        server_ptr = new SunSpecServer (ini_map["Server"]);
+        for (auto& did : tsu::SplitString (ini_map["Server"]["models"], ',')) {
+            server_ptr->AddModel (stoul (did), ini_map["Server." + did]);
+        }
+        server_ptr->Start ();
     }
-    
-    cout << "\n\t\tWriteModel Test: \n";
-    bms.WriteModel (99001, points);
+
+    // the resource model steps on absolute deadlines so its period does
+    // not drift with the time the step takes
+    Executor executor;
+    executor.AddTask (
+        "DER",
+        chrono::milliseconds (stoul(ini_map["DER"]["ThreadPeriod"])),
+        [der_ptr, server_ptr] (double delta_ms) {
+            der_ptr->Loop (delta_ms);
+            if (server_ptr) {
+                server_ptr->Publish (der_ptr);
+            }
+        }
+    );
+    executor.Start ();
 
     cout << "\nProgram initialization complete...\n";
-    thread DER(ResourceLoop, der_ptr, stoul(ini_map["DER"]["ThreadPeriod"]));
 
     // CLI Loop
     Help ();
     string input;
     while (!done) {
         getline(cin, input);
-        done = CommandLineInterface(input, der_ptr);
+        done = CommandLineInterface(input, der_ptr, &poller, &executor);
     }
 
     cout << "\nProgram shutting down...\n";
     cout << "\n\t Joining threads...\n";
-    DER.join();
+    executor.Stop ();
+    if (server_ptr) {
+        server_ptr->Stop ();
+    }
+    poller.Stop ();
 
     cout << "\n\t deleting pointers...\n";
+    delete server_ptr;
     delete der_ptr;
 
+    LogWriter::Instance ().Stop ();
+
     return EXIT_SUCCESS;
 } // end main
@@ -0,0 +1,30 @@
+// SMDX Catalog
+// - build the binary sunspec model catalog from the models listed in the
+// - smdx manifest.xml so devices can load it instead of parsing xml.
+// - Example:
+//  bin/debug/smdx_catalog ../data/models/smdx ../data/models/smdx.cat
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "SunSpecCatalog.h"
+
+int main (int argc, char** argv) {
+    if (argc != 3) {
+        std::cout << "\n[Usage] > " << argv[0] << " smdx_directory catalog"
+            << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    SunSpecCatalog& catalog = SunSpecCatalog::Instance ();
+    catalog.SetPath (argv[1]);
+
+    std::vector <unsigned int> dids = catalog.ReadManifest ();
+    if (!catalog.WriteBinary (argv[2], dids)) {
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "\n\tWrote " << dids.size () << " models to " << argv[2]
+        << std::endl;
+    return EXIT_SUCCESS;
+}  // end main